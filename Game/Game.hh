@@ -1,48 +1,356 @@
 #pragma once
 
-#include <vector>
+#include "Kernels.hh"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
 
 enum class Move { UP, DOWN, LEFT, RIGHT };
 
-class Game {
+constexpr Move inverse(Move move) {
+    return static_cast<Move>(static_cast<int32_t>(move) ^ 1);
+}
+
+// Set of moves stored as a bitmask, one bit per Move. Iterating it yields the
+// moves in enum order without touching the heap.
+class MoveSet {
 public:
-    using Board = std::vector<int>;
+    class iterator {
+    public:
+        constexpr explicit iterator(uint8_t mask) :
+            _mask(mask) {}
+
+        constexpr Move operator*() const {
+            return static_cast<Move>(std::countr_zero(_mask));
+        }
+
+        constexpr iterator& operator++() {
+            _mask &= static_cast<uint8_t>(_mask - 1);
+            return *this;
+        }
+
+        constexpr bool operator==(const iterator& p) const = default;
+
+    private:
+        uint8_t _mask;
+    };
+
+    constexpr MoveSet() = default;
+
+    constexpr explicit MoveSet(uint8_t mask) :
+        _mask(mask) {}
+
+    constexpr iterator begin() const {
+        return iterator {_mask};
+    }
+
+    constexpr iterator end() const {
+        return iterator {0};
+    }
+
+    constexpr bool contains(Move move) const {
+        return (_mask >> static_cast<int32_t>(move)) & 1;
+    }
 
-    Game();
-    Game(const Game& p);
-    Game(Game&& p);
+    constexpr MoveSet without(Move move) const {
+        return MoveSet {static_cast<uint8_t>(_mask & ~(1 << static_cast<int32_t>(move)))};
+    }
+
+    constexpr int32_t size() const {
+        return std::popcount(_mask);
+    }
+
+    constexpr Move operator[](int32_t index) const {
+        uint8_t mask {_mask};
+        for (int32_t i {0}; i < index; i++)
+            mask &= static_cast<uint8_t>(mask - 1);
+
+        return static_cast<Move>(std::countr_zero(mask));
+    }
+
+    constexpr uint8_t mask() const {
+        return _mask;
+    }
+
+private:
+    uint8_t _mask {};
+};
+
+// Boards of up to 16 cells are packed into a single 64-bit word, one nibble
+// per cell. The blank cell always holds zero, so moving a tile is two xors.
+template <int32_t N>
+class PackedBoard {
+public:
+    static_assert(N * N <= 16, "PackedBoard holds at most 16 nibbles");
 
-    bool operator==(const Game& p) const;
-    Game& operator=(const Game& p);
-    Game& operator=(Game&& p);
+    bool operator==(const PackedBoard& p) const = default;
 
-    bool move(Move move);
-    bool move(int);
+    int32_t get(int32_t index) const {
+        return static_cast<int32_t>((_bits >> (index * 4)) & 0xF);
+    }
+
+    void set(int32_t index, int32_t value) {
+        _bits &= ~(uint64_t {0xF} << (index * 4));
+        _bits |= static_cast<uint64_t>(value & 0xF) << (index * 4);
+    }
+
+    void swapBlank(int32_t blank, int32_t index) {
+        uint64_t value {(_bits >> (index * 4)) & 0xF};
+        _bits ^= (value << (index * 4)) ^ (value << (blank * 4));
+    }
+
+    uint64_t bits() const {
+        return _bits;
+    }
+
+private:
+    uint64_t _bits {};
+};
+
+// Larger boards do not fit a register and fall back to one byte per cell,
+// padded to a block the SIMD kernels compare in one or two instructions.
+template <int32_t N>
+class ArrayBoard {
+public:
+    static_assert(N * N <= BoardKernels::Block, "ArrayBoard holds at most one kernel block");
+
+    bool operator==(const ArrayBoard& p) const {
+        return boardKernels().equal(_cells.data(), p._cells.data());
+    }
+
+    int32_t get(int32_t index) const {
+        return _cells[index];
+    }
+
+    void set(int32_t index, int32_t value) {
+        _cells[index] = static_cast<uint8_t>(value);
+    }
+
+    void swapBlank(int32_t blank, int32_t index) {
+        _cells[blank] = _cells[index];
+        _cells[index] = 0;
+    }
+
+    const uint8_t* data() const {
+        return _cells.data();
+    }
+
+private:
+    std::array<uint8_t, BoardKernels::Block> _cells {};
+};
+
+template <int32_t N>
+using BoardStorage = std::conditional_t<(N * N <= 16), PackedBoard<N>, ArrayBoard<N>>;
+
+template <int32_t N>
+class BasicGame {
+public:
+    using Board = BoardStorage<N>;
+
+    static constexpr int32_t Dimension {N};
+    static constexpr int32_t Size {N * N};
+
+    static constexpr int32_t row(int32_t index) {
+        return index / N;
+    }
+
+    static constexpr int32_t col(int32_t index) {
+        return index % N;
+    }
+
+    // Cell reached from each position in each Move direction, or -1 at the edge.
+    static constexpr std::array<std::array<int8_t, 4>, Size> Neighbours = [] {
+        std::array<std::array<int8_t, 4>, Size> table {};
+        for (int32_t i {0}; i < Size; i++) {
+            table[i][static_cast<int32_t>(Move::UP)] = static_cast<int8_t>(row(i) > 0 ? i - N : -1);
+            table[i][static_cast<int32_t>(Move::DOWN)] = static_cast<int8_t>(row(i) < N - 1 ? i + N : -1);
+            table[i][static_cast<int32_t>(Move::LEFT)] = static_cast<int8_t>(col(i) > 0 ? i - 1 : -1);
+            table[i][static_cast<int32_t>(Move::RIGHT)] = static_cast<int8_t>(col(i) < N - 1 ? i + 1 : -1);
+        }
+        return table;
+    }();
+
+    // Legal moves for each blank position.
+    static constexpr std::array<MoveSet, Size> Moves = [] {
+        std::array<MoveSet, Size> table {};
+        for (int32_t i {0}; i < Size; i++) {
+            uint8_t mask {0};
+            for (int32_t move {0}; move < 4; move++) {
+                if (Neighbours[i][move] >= 0)
+                    mask |= static_cast<uint8_t>(1 << move);
+            }
+            table[i] = MoveSet {mask};
+        }
+        return table;
+    }();
+
+    // Cells a tile can slide from into each blank position, one bit per cell.
+    static constexpr std::array<uint32_t, Size> Adjacent = [] {
+        std::array<uint32_t, Size> table {};
+        for (int32_t i {0}; i < Size; i++) {
+            for (int32_t move {0}; move < 4; move++) {
+                if (Neighbours[i][move] >= 0)
+                    table[i] |= 1U << Neighbours[i][move];
+            }
+        }
+        return table;
+    }();
+
+    // Zobrist keys for each (cell, value) pair. The blank contributes nothing:
+    // its position is implied by the tiles.
+    static constexpr std::array<std::array<uint64_t, Size>, Size> Zobrist = [] {
+        std::array<std::array<uint64_t, Size>, Size> table {};
+        uint64_t state {0x9E3779B97F4A7C15ULL * N};
+        for (int32_t i {0}; i < Size; i++) {
+            for (int32_t value {1}; value < Size; value++) {
+                state += 0x9E3779B97F4A7C15ULL;
+                uint64_t z {state};
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                table[i][value] = z ^ (z >> 31);
+            }
+        }
+        return table;
+    }();
+
+    using Cells = std::array<int8_t, Size>;
+
+    BasicGame();
+    explicit BasicGame(const Cells& cells);
+
+    bool operator==(const BasicGame& p) const {
+        return _board == p._board;
+    }
+
+    bool move(Move move) {
+        int32_t target {Neighbours[_blank][static_cast<int32_t>(move)]};
+        if (target < 0)
+            return false;
+
+        slide(target);
+        return true;
+    }
+
+    // Slides the tile at index if it is next to the blank.
+    bool move(int32_t index) {
+        if (index < 0 || index >= Size || ((Adjacent[_blank] >> index) & 1) == 0)
+            return false;
+
+        slide(index);
+        return true;
+    }
+
+    int32_t get(int32_t index) const {
+        return _board.get(index);
+    }
+
+    int32_t get(int32_t row, int32_t col) const {
+        return _board.get(row * N + col);
+    }
 
-    const int& get(int32_t index) const;
-    const int& get(int32_t row, int32_t col) const;
-    int& get(int32_t index);
-    int& get(int32_t row, int32_t col);
     void set(int32_t index, int32_t value);
     void set(int32_t row, int32_t col, int32_t value);
 
-    int32_t inversionCount() const;
+    int32_t inversionCount() const {
+        return _inversions;
+    }
+
+    int32_t misplacedCount() const {
+        return _misplaced;
+    }
 
     bool isSolvable() const;
-    bool isSolved() const;
 
-    std::vector<Move> validMoves() const;
+    bool isSolved() const {
+        return _misplaced == 0;
+    }
+
+    MoveSet validMoves() const {
+        return Moves[_blank];
+    }
+
+    // Legal moves that do not undo the previous one.
+    MoveSet validMoves(Move previous) const {
+        return Moves[_blank].without(inverse(previous));
+    }
+
     void shuffle();
     void reset();
 
-    int32_t dimension() const;
-    int32_t size() const;
+    int32_t dimension() const {
+        return N;
+    }
+
+    int32_t size() const {
+        return Size;
+    }
+
+    int32_t blank() const {
+        return _blank;
+    }
 
-    Board& board();
+    uint64_t hash() const {
+        return _hash;
+    }
+
+    const Board& board() const {
+        return _board;
+    }
 
 private:
-    int32_t _blankRow {};
-    int32_t _blankCol {};
-    int32_t _dimension {};
+    static constexpr int32_t goal(int32_t index) {
+        return index == Size - 1 ? 0 : index + 1;
+    }
+
+    void slide(int32_t index);
+    int32_t inversionsAt(int32_t index, int32_t value) const;
+
     Board _board {};
+    uint64_t _hash {};
+    int32_t _blank {};
+    int16_t _inversions {};
+    int16_t _misplaced {};
+};
+
+// Slides the tile at index into the blank cell. Horizontal slides keep the
+// reading order of the tiles, a vertical one jumps the tile over the N - 1
+// cells in between and flips its order against each of them.
+template <int32_t N>
+inline void BasicGame<N>::slide(int32_t index) {
+    int32_t tile {_board.get(index)};
+
+    if (index < _blank - 1 || index > _blank + 1) {
+        int32_t first {std::min(index, _blank) + 1};
+        int32_t last {std::max(index, _blank)};
+        int32_t delta {0};
+
+        for (int32_t i {first}; i < last; i++)
+            delta += _board.get(i) > tile ? 1 : -1;
+
+        _inversions += static_cast<int16_t>(index < _blank ? delta : -delta);
+    }
+
+    _misplaced += static_cast<int16_t>(
+        (tile != goal(_blank)) + (goal(index) != 0) - (tile != goal(index)) - (goal(_blank) != 0)
+    );
+
+    _hash ^= Zobrist[index][tile] ^ Zobrist[_blank][tile];
+    _board.swapBlank(_blank, index);
+    _blank = index;
+}
+
+template <int32_t N>
+struct std::hash<BasicGame<N>> {
+    size_t operator()(const BasicGame<N>& game) const noexcept {
+        return static_cast<size_t>(game.hash());
+    }
 };
+
+extern template class BasicGame<3>;
+extern template class BasicGame<4>;
+extern template class BasicGame<5>;
+
+using Game = BasicGame<4>;
@@ -105,6 +105,7 @@ void GameApplication::renderInfo() {
     ImGui::Begin("Info", nullptr, commonFlags);
     {
         if (ImGui::Button("New game")) {
+            stopSolver();
             _game.shuffle();
             _state = GameState::PLAYING;
             _startTime = std::chrono::steady_clock::now();
@@ -114,6 +115,7 @@ void GameApplication::renderInfo() {
         ImGui::SameLine();
 
         if (ImGui::Button("Reset")) {
+            stopSolver();
             _game.reset();
             _state = GameState::NONE;
         }
@@ -175,15 +177,49 @@ void GameApplication::renderSolver() {
         if (_state == GameState::PLAYING) {
             if (ImGui::Button("Solve")) {
                 _state = GameState::SOLVING;
-                std::thread([&] {
-                    _solverStep = 0;
-                    _solver.reset(_game);
-                    _solver.solve(ManhattanDistance());
-                    _state = GameState::SOLVER;
-                }).detach();
+                _solverStep = 0;
+                _solver.reset(_game);
+                _solver.setThreads(static_cast<int32_t>(std::thread::hardware_concurrency()));
+                _solver.setMode(SearchMode::BOUNDED, 1.5F);
+                _solverRunning = true;
+
+                HeuristicKind kind {static_cast<HeuristicKind>(_heuristic)};
+                _solverThread = std::jthread([this, kind](std::stop_token stop) {
+                    // Null if stopped while its pattern databases were built.
+                    if (auto heuristic = makeHeuristic<Game::Dimension>(kind, stop))
+                        _solver.solve(*heuristic, stop);
+                    _solverRunning = false;
+                });
             }
+
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(-1.F);
+            ImGui::Combo("##Heuristic", &_heuristic, HeuristicNames, static_cast<int32_t>(std::size(HeuristicNames)));
         } else if (_state == GameState::SOLVING) {
-            ImGui::Text("Solving...");
+            if (!_solverRunning) {
+                _state = GameState::PLAYING;
+                // Stopped before the search began, there is no result to read.
+                if (!_solverThread.get_stop_token().stop_requested()) {
+                    if (_solver.result() == SolverResult::OK)
+                        _state = GameState::SOLVER;
+                    else if (_solver.result() != SolverResult::CANCELLED)
+                        _error = "Solver found no solution";
+                }
+            } else {
+                SolverProgress progress {_solver.progress()};
+
+                if (ImGui::Button("Abort")) {
+                    _solverThread.request_stop();
+                }
+
+                ImGui::SameLine();
+                ImGui::Text("%.2fM nodes/s", progress.nodesPerSecond / 1e6F);
+                ImGui::Text(
+                    ">= %.1f moves, %llu nodes",
+                    progress.threshold,
+                    static_cast<unsigned long long>(progress.nodes)
+                );
+            }
         } else if (_state == GameState::FINISHED) {
             ImGui::Text("Game is already solved");
         }
@@ -195,7 +231,11 @@ void GameApplication::renderSolver() {
             }
 
             ImGui::SameLine();
-            ImGui::Text("Elapsed: %.2fs", _solver.elapsed().count() / 1000.F);
+            ImGui::Text(
+                "%.2fs, %llu nodes",
+                _solver.elapsed().count() / 1000.F,
+                static_cast<unsigned long long>(_solver.nodes())
+            );
 
             if (ImGui::Button("Prev")) {
                 if (_solverStep > 0) {
@@ -205,7 +245,7 @@ void GameApplication::renderSolver() {
             }
 
             ImGui::SameLine();
-            ImGui::Text("%d/%zu", _solverStep, _solver.path().size() - 1);
+            ImGui::Text("%d/%d (>= %d)", _solverStep, _solver.length(), _solver.lowerBound());
             ImGui::SameLine();
 
             if (ImGui::Button("Next")) {
@@ -219,6 +259,15 @@ void GameApplication::renderSolver() {
     ImGui::End();
 }
 
+// Asks a running solve to stop and waits for it, which takes at most a few
+// thousand nodes, or a chunk of a pattern database layer while one is built.
+void GameApplication::stopSolver() {
+    if (_solverThread.joinable()) {
+        _solverThread.request_stop();
+        _solverThread.join();
+    }
+}
+
 void GameApplication::renderScene(float /*dt*/) {
     renderGame();
     renderInfo();
@@ -3,7 +3,9 @@
 #include "Application.hh"
 #include "Game.hh"
 #include "Solver.hh"
+#include <atomic>
 #include <string_view>
+#include <thread>
 
 enum class GameState { NONE, PLAYING, SOLVING, SOLVER, FINISHED };
 
@@ -19,6 +21,7 @@ private:
     void renderGame();
     void renderInfo();
     void renderSolver();
+    void stopSolver();
 
     void saveState();
     void loadState();
@@ -29,8 +32,12 @@ private:
     std::chrono::seconds _elapsedTime;
     Solver _solver;
     uint32_t _solverStep {0};
+    int32_t _heuristic {0};
     GameState _state {GameState::NONE};
     std::string_view _error {};
+    std::atomic<bool> _solverRunning {false};
+    // Declared last so it is stopped and joined before anything it uses goes.
+    std::jthread _solverThread {};
 
 public:
     virtual ~GameApplication() = default;
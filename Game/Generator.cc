@@ -0,0 +1,59 @@
+#include "Generator.hh"
+#include "Permutation.hh"
+#include <bit>
+
+template <int32_t N>
+typename BasicGenerator<N>::Game BasicGenerator<N>::next() {
+    typename Game::Cells cells {};
+    for (int32_t i {0}; i < Game::Size; i++)
+        cells[i] = static_cast<int8_t>(i);
+
+    for (int32_t i {Game::Size - 1}; i > 0; i--)
+        std::swap(cells[i], cells[bounded(static_cast<uint32_t>(i + 1))]);
+
+    uint32_t seen {0};
+    int32_t inversions {0};
+    int32_t blank {0};
+    for (int32_t i {0}; i < Game::Size; i++) {
+        if (cells[i] == 0) {
+            blank = i;
+            continue;
+        }
+
+        inversions += std::popcount(seen >> cells[i]);
+        seen |= 1U << cells[i];
+    }
+
+    if ((inversions & 1) != solvableParity<N>(blank)) {
+        int32_t first {cells[0] == 0 ? 1 : 0};
+        int32_t second {cells[first + 1] == 0 ? first + 2 : first + 1};
+        std::swap(cells[first], cells[second]);
+    }
+
+    return Game {cells};
+}
+
+// Unbiased integer in [0, range) by Lemire's multiply-and-reject, which
+// avoids the division std::uniform_int_distribution pays on every draw.
+template <int32_t N>
+uint32_t BasicGenerator<N>::bounded(uint32_t range) {
+    uint64_t product {static_cast<uint64_t>(static_cast<uint32_t>(_rng())) * range};
+
+    if (static_cast<uint32_t>(product) < range) {
+        uint32_t threshold {(0U - range) % range};
+        while (static_cast<uint32_t>(product) < threshold)
+            product = static_cast<uint64_t>(static_cast<uint32_t>(_rng())) * range;
+    }
+
+    return static_cast<uint32_t>(product >> 32);
+}
+
+template <int32_t N>
+void BasicGenerator<N>::fill(std::span<Game> games) {
+    for (Game& game : games)
+        game = next();
+}
+
+template class BasicGenerator<3>;
+template class BasicGenerator<4>;
+template class BasicGenerator<5>;
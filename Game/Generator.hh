@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Game.hh"
+#include <cstdint>
+#include <random>
+#include <span>
+
+// Draws solvable boards uniformly at random: a Fisher-Yates shuffle of all
+// cells, with two tiles swapped whenever the result has the wrong parity.
+// Swapping maps unsolvable boards one-to-one onto solvable ones, so every
+// solvable board is equally likely. The same seed yields the same sequence.
+template <int32_t N>
+class BasicGenerator {
+public:
+    using Game = BasicGame<N>;
+
+    explicit BasicGenerator(uint64_t seed) :
+        _rng(seed) {}
+
+    Game next();
+
+    // Fills a contiguous buffer, e.g. a benchmark corpus, in one call.
+    void fill(std::span<Game> games);
+
+private:
+    uint32_t bounded(uint32_t range);
+
+    std::mt19937_64 _rng;
+};
+
+using Generator = BasicGenerator<4>;
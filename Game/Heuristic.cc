@@ -1,23 +1,198 @@
 #include "Heuristic.hh"
-#include "Game.hh"
-#include <cmath>
+#include "PatternDatabase.hh"
 
-uint32_t ManhattanDistance::solve(const Game& game) const {
+template <int32_t N>
+uint32_t BasicManhattanDistance<N>::solve(const Game& game) const {
     uint32_t distance = 0;
 
-    int dimension = game.dimension();
+    for (int32_t n = 0; n < Game::Size; n++)
+        distance += Distance[game.get(n)][n];
 
-    for (int n = 0, len = game.size(); n < len; n++) {
-        if (game.get(n) == 0)
-            continue;
+    return distance;
+}
 
-        int realValue {game.get(n) - 1};
-        if (realValue == n)
-            continue;
+template <int32_t N>
+uint32_t BasicLinearConflict<N>::solve(const Game& game) const {
+    auto cells = [&](int32_t index) {
+        return game.get(index);
+    };
 
-        distance += std::abs((realValue / dimension) - (n / dimension))
-                    + std::abs((realValue % dimension) - (n % dimension));
-    }
+    uint32_t distance {BasicManhattanDistance<N> {}.solve(game)};
+    for (int32_t line {0}; line < N; line++)
+        distance += rowPenalty(line, cells) + colPenalty(line, cells);
 
     return distance;
 }
+
+// Breadth-first search from the goal configuration, one pass over the table
+// per layer. A move takes a tile from a line next to the blank's into it.
+template <int32_t N>
+const std::array<uint8_t, BasicWalkingDistance<N>::Keys>& BasicWalkingDistance<N>::distances() {
+    static const std::array<uint8_t, Keys> table = [] {
+        std::array<uint8_t, Keys> distances {};
+        distances.fill(Unknown);
+
+        std::array<int32_t, Full> full {};
+        std::array<int32_t, Partial> partial {};
+        for (int32_t digits {0}; digits < Digits; digits++) {
+            int32_t sum {0};
+            for (int32_t rest {digits}; rest != 0; rest /= N + 1)
+                sum += rest % (N + 1);
+
+            if (sum == N)
+                full[Rank[digits]] = digits;
+            else if (sum == N - 1)
+                partial[Rank[digits]] = digits;
+        }
+
+        std::array<int32_t, N> lines {};
+        for (int32_t line {0}; line < N; line++)
+            lines[line] = (line == N - 1 ? N - 1 : N) * Power[line];
+        distances[key(lines, N - 1)] = 0;
+
+        int32_t rest {Keys / (N * Partial)};
+        int32_t reached {1};
+        for (uint8_t depth {0}; reached != 0; depth++) {
+            reached = 0;
+
+            for (int32_t current {0}; current < Keys; current++) {
+                if (distances[current] != depth)
+                    continue;
+
+                int32_t blank {current / rest / Partial};
+                lines[blank] = partial[current / rest % Partial];
+                lines[last(blank)] = Total - lines[blank];
+                for (int32_t line {N - 1}, tail {current % rest}; line >= 0; line--) {
+                    if (line != blank && line != last(blank)) {
+                        lines[line] = full[tail % Full];
+                        lines[last(blank)] -= lines[line];
+                        tail /= Full;
+                    }
+                }
+
+                for (int32_t next : {blank - 1, blank + 1}) {
+                    if (next < 0 || next >= N)
+                        continue;
+
+                    for (int32_t goal {0}; goal < N; goal++) {
+                        if (lines[next] / Power[goal] % (N + 1) == 0)
+                            continue;
+
+                        std::array<int32_t, N> moved {lines};
+                        moved[next] -= Power[goal];
+                        moved[blank] += Power[goal];
+
+                        uint8_t& distance {distances[key(moved, next)]};
+                        if (distance == Unknown) {
+                            distance = static_cast<uint8_t>(depth + 1);
+                            reached++;
+                        }
+                    }
+                }
+            }
+        }
+
+        return distances;
+    }();
+
+    return table;
+}
+
+template <int32_t N>
+uint32_t BasicWalkingDistance<N>::solve(const Game& game) const {
+    int32_t blank {game.blank()};
+
+    return _distances[key(rows(game), Game::row(blank))] + _distances[key(cols(game), Game::col(blank))];
+}
+
+template <int32_t N>
+typename BasicMaxHeuristic<N>::Stats BasicMaxHeuristic<N>::stats(size_t index) const {
+    const Counters& counters {_counters[index]};
+    return {
+        counters.evaluations.load(std::memory_order_relaxed),
+        counters.raised.load(std::memory_order_relaxed),
+        counters.cutoffs.load(std::memory_order_relaxed),
+    };
+}
+
+template <int32_t N>
+void BasicMaxHeuristic<N>::resetStats() {
+    for (Counters& counters : _counters) {
+        counters.evaluations.store(0, std::memory_order_relaxed);
+        counters.raised.store(0, std::memory_order_relaxed);
+        counters.cutoffs.store(0, std::memory_order_relaxed);
+    }
+}
+
+template <int32_t N>
+std::unique_ptr<BasicHeuristic<N>> makeHeuristic(HeuristicKind kind, std::stop_token stop) {
+    switch (kind) {
+    case HeuristicKind::MAXIMUM: {
+        std::vector<std::unique_ptr<BasicHeuristic<N>>> components;
+        components.push_back(std::make_unique<BasicManhattanDistance<N>>());
+        if constexpr (N <= 4)
+            components.push_back(std::make_unique<BasicWalkingDistance<N>>());
+        else
+            components.push_back(std::make_unique<BasicLinearConflict<N>>());
+        // The maximum looks up every board whole, which MOD3 tables are far
+        // too slow for.
+        if constexpr (N == 4) {
+            auto databases = patternDatabases(Partition::SIX_SIX_THREE, true, stop);
+            if (!databases)
+                return nullptr;
+
+            components.push_back(std::make_unique<BasicPatternDatabaseHeuristic<N>>(std::move(databases)));
+        }
+
+        return std::make_unique<BasicMaxHeuristic<N>>(std::move(components));
+    }
+    case HeuristicKind::PATTERN_DATABASE:
+    case HeuristicKind::REFLECTED_PATTERN_DATABASE:
+    case HeuristicKind::ALTERNATING_PATTERN_DATABASE:
+        if constexpr (N == 4) {
+            PatternReflection reflection {PatternReflection::NONE};
+            if (kind == HeuristicKind::REFLECTED_PATTERN_DATABASE)
+                reflection = PatternReflection::MAXIMUM;
+            else if (kind == HeuristicKind::ALTERNATING_PATTERN_DATABASE)
+                reflection = PatternReflection::ALTERNATE;
+
+            // Reflected lookups go through solve() at every node.
+            auto databases = patternDatabases(Partition::SIX_SIX_THREE, reflection != PatternReflection::NONE, stop);
+            if (!databases)
+                return nullptr;
+
+            return std::make_unique<BasicPatternDatabaseHeuristic<N>>(std::move(databases), reflection);
+        } else {
+            return makeHeuristic<N>(HeuristicKind::WALKING_DISTANCE);
+        }
+    case HeuristicKind::WALKING_DISTANCE:
+        if constexpr (N <= 4)
+            return std::make_unique<BasicWalkingDistance<N>>();
+        else
+            return std::make_unique<BasicLinearConflict<N>>();
+    case HeuristicKind::LINEAR_CONFLICT:
+        return std::make_unique<BasicLinearConflict<N>>();
+    case HeuristicKind::MANHATTAN_DISTANCE:
+    default:
+        return std::make_unique<BasicManhattanDistance<N>>();
+    }
+}
+
+template class BasicManhattanDistance<3>;
+template class BasicManhattanDistance<4>;
+template class BasicManhattanDistance<5>;
+
+template class BasicLinearConflict<3>;
+template class BasicLinearConflict<4>;
+template class BasicLinearConflict<5>;
+
+template class BasicWalkingDistance<3>;
+template class BasicWalkingDistance<4>;
+
+template class BasicMaxHeuristic<3>;
+template class BasicMaxHeuristic<4>;
+template class BasicMaxHeuristic<5>;
+
+template std::unique_ptr<BasicHeuristic<3>> makeHeuristic<3>(HeuristicKind kind, std::stop_token stop);
+template std::unique_ptr<BasicHeuristic<4>> makeHeuristic<4>(HeuristicKind kind, std::stop_token stop);
+template std::unique_ptr<BasicHeuristic<5>> makeHeuristic<5>(HeuristicKind kind, std::stop_token stop);
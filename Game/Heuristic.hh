@@ -1,15 +1,491 @@
 #pragma once
 
+#include "Game.hh"
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
-class Game;
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <stop_token>
+#include <vector>
 
-class Heuristic {
+template <int32_t N>
+class BasicHeuristic {
 public:
-    virtual uint32_t solve(const Game& game) const = 0;
-    virtual ~Heuristic() = default;
+    virtual uint32_t solve(const BasicGame<N>& game) const = 0;
+
+    // Estimate for game right after the blank took `move` from a board whose
+    // estimate was h. Heuristics that can do better than a full recompute
+    // override it; solve() stays the reference.
+    virtual uint32_t update(const BasicGame<N>& game, Move move, uint32_t h) const {
+        (void)move;
+        (void)h;
+        return solve(game);
+    }
+
+    virtual ~BasicHeuristic() = default;
+
+protected:
+    // Cell the moved tile came from is the new blank; it went to the cell
+    // the blank left.
+    static int32_t movedTo(const BasicGame<N>& game, Move move) {
+        return BasicGame<N>::Neighbours[game.blank()][static_cast<int32_t>(inverse(move))];
+    }
 };
 
-class ManhattanDistance : public Heuristic {
+template <int32_t N>
+class BasicManhattanDistance final : public BasicHeuristic<N> {
+public:
+    using Game = BasicGame<N>;
+
+    // Distance of each tile from each cell to its goal cell.
+    static constexpr std::array<std::array<uint8_t, Game::Size>, Game::Size> Distance = [] {
+        std::array<std::array<uint8_t, Game::Size>, Game::Size> table {};
+        for (int32_t tile {1}; tile < Game::Size; tile++) {
+            for (int32_t cell {0}; cell < Game::Size; cell++) {
+                table[tile][cell] = static_cast<uint8_t>(
+                    std::abs(Game::row(tile - 1) - Game::row(cell)) + std::abs(Game::col(tile - 1) - Game::col(cell))
+                );
+            }
+        }
+        return table;
+    }();
+
+    uint32_t solve(const Game& game) const;
+    uint32_t update(const Game& game, Move move, uint32_t h) const;
+};
+
+// Only one tile moved, by exactly one cell.
+template <int32_t N>
+inline uint32_t BasicManhattanDistance<N>::update(const Game& game, Move move, uint32_t h) const {
+    int32_t from {game.blank()};
+    int32_t to {this->movedTo(game, move)};
+    int32_t tile {game.get(to)};
+
+    return h - Distance[tile][from] + Distance[tile][to];
+}
+
+// Manhattan distance plus two moves for every tile that has to leave its
+// goal row or column to let another tile of that line pass. The penalty of a
+// line is twice the number of its goal tiles outside the longest increasing
+// run, looked up by a key of the goal offsets of the tiles it holds.
+template <int32_t N>
+class BasicLinearConflict final : public BasicHeuristic<N> {
 public:
+    using Game = BasicGame<N>;
+
+    static constexpr int32_t Keys {[] {
+        int32_t keys {1};
+        for (int32_t i {0}; i < N; i++)
+            keys *= N + 1;
+        return keys;
+    }()};
+
+    // Penalty of a line per key. A key has one base N + 1 digit per cell:
+    // 0 when the tile there belongs to another line, its goal offset in this
+    // line plus one otherwise.
+    static constexpr std::array<uint8_t, Keys> Penalty = [] {
+        std::array<uint8_t, Keys> table {};
+        for (int32_t key {0}; key < Keys; key++) {
+            std::array<int32_t, N> digits {};
+            for (int32_t i {N - 1}, rest {key}; i >= 0; i--, rest /= N + 1)
+                digits[i] = rest % (N + 1);
+
+            std::array<int32_t, N> longest {};
+            int32_t tiles {0};
+            int32_t run {0};
+            for (int32_t i {0}; i < N; i++) {
+                if (digits[i] == 0)
+                    continue;
+
+                tiles++;
+                longest[i] = 1;
+                for (int32_t j {0}; j < i; j++) {
+                    if (digits[j] != 0 && digits[j] < digits[i] && longest[j] + 1 > longest[i])
+                        longest[i] = longest[j] + 1;
+                }
+                run = longest[i] > run ? longest[i] : run;
+            }
+
+            table[key] = static_cast<uint8_t>(2 * (tiles - run));
+        }
+        return table;
+    }();
+
     uint32_t solve(const Game& game) const;
+    uint32_t update(const Game& game, Move move, uint32_t h) const;
+
+private:
+    template <typename Cells>
+    static uint32_t rowPenalty(int32_t row, const Cells& cells);
+
+    template <typename Cells>
+    static uint32_t colPenalty(int32_t col, const Cells& cells);
 };
+
+template <int32_t N>
+template <typename Cells>
+inline uint32_t BasicLinearConflict<N>::rowPenalty(int32_t row, const Cells& cells) {
+    int32_t key {0};
+    for (int32_t col {0}; col < N; col++) {
+        int32_t tile {cells(row * N + col)};
+        key = key * (N + 1) + (tile != 0 && Game::row(tile - 1) == row ? Game::col(tile - 1) + 1 : 0);
+    }
+
+    return Penalty[key];
+}
+
+template <int32_t N>
+template <typename Cells>
+inline uint32_t BasicLinearConflict<N>::colPenalty(int32_t col, const Cells& cells) {
+    int32_t key {0};
+    for (int32_t row {0}; row < N; row++) {
+        int32_t tile {cells(row * N + col)};
+        key = key * (N + 1) + (tile != 0 && Game::col(tile - 1) == col ? Game::row(tile - 1) + 1 : 0);
+    }
+
+    return Penalty[key];
+}
+
+// Only the lines the moved tile left and entered can change their penalty:
+// both columns for a horizontal move, both rows for a vertical one. The line
+// it moves along keeps its tiles in the same order. Old penalties are read
+// with the tile put back.
+template <int32_t N>
+inline uint32_t BasicLinearConflict<N>::update(const Game& game, Move move, uint32_t h) const {
+    int32_t from {game.blank()};
+    int32_t to {this->movedTo(game, move)};
+    int32_t tile {game.get(to)};
+
+    auto after = [&](int32_t index) {
+        return game.get(index);
+    };
+    auto before = [&](int32_t index) {
+        return index == from ? tile : index == to ? 0 : game.get(index);
+    };
+
+    int32_t delta {BasicManhattanDistance<N>::Distance[tile][to] - BasicManhattanDistance<N>::Distance[tile][from]};
+
+    if (Game::row(from) == Game::row(to)) {
+        delta += colPenalty(Game::col(from), after) - colPenalty(Game::col(from), before);
+        delta += colPenalty(Game::col(to), after) - colPenalty(Game::col(to), before);
+    } else {
+        delta += rowPenalty(Game::row(from), after) - rowPenalty(Game::row(from), before);
+        delta += rowPenalty(Game::row(to), after) - rowPenalty(Game::row(to), before);
+    }
+
+    return static_cast<uint32_t>(static_cast<int32_t>(h) + delta);
+}
+
+// Moves needed to bring every tile into its goal row, knowing only how many
+// tiles of each goal row every row holds, plus the same for columns. A
+// vertical move changes only the row counts and a horizontal one only the
+// column counts, so the two add up. Both are read from one table of every
+// count configuration reachable from the goal, since the goal columns are
+// laid out like the goal rows.
+//
+// The counts of a line are kept as base N + 1 digits, one per goal line, so
+// moving a tile adds and subtracts a power. A configuration is keyed by the
+// line holding the blank and the rank of the counts of every line but the
+// last full one, which the others determine. The 5x5 table would need 700M
+// keys for its 65M configurations, so only smaller boards are supported.
+template <int32_t N>
+class BasicWalkingDistance final : public BasicHeuristic<N> {
+    static_assert(N <= 4);
+
+public:
+    using Game = BasicGame<N>;
+
+    static constexpr uint8_t Unknown {0xFF};
+
+    static constexpr std::array<int32_t, N> Power = [] {
+        std::array<int32_t, N> power {};
+        for (int32_t i {0}, value {1}; i < N; i++, value *= N + 1)
+            power[i] = value;
+        return power;
+    }();
+
+    static constexpr int32_t Digits {Power[N - 1] * (N + 1)};
+
+    // Counts of all lines together: N tiles of every goal line but the last.
+    static constexpr int32_t Total {Digits - 1 - Power[N - 1]};
+
+    // Rank of the counts of a line among those adding up to N, or N - 1 for
+    // the line holding the blank; -1 for any other sum.
+    static constexpr std::array<int16_t, Digits> Rank = [] {
+        std::array<int16_t, Digits> rank {};
+        int16_t full {0};
+        int16_t partial {0};
+        for (int32_t digits {0}; digits < Digits; digits++) {
+            int32_t sum {0};
+            for (int32_t rest {digits}; rest != 0; rest /= N + 1)
+                sum += rest % (N + 1);
+
+            rank[digits] = sum == N ? full++ : sum == N - 1 ? partial++ : -1;
+        }
+        return rank;
+    }();
+
+    // Number of ranks of lines without and with the blank. More counts add
+    // up to N than to N - 1, and the largest adding up to N - 1 has every
+    // tile in the last digit.
+    static constexpr int32_t Full {*std::max_element(Rank.begin(), Rank.end()) + 1};
+    static constexpr int32_t Partial {Rank[(N - 1) * Power[N - 1]] + 1};
+
+    static constexpr int32_t Keys {[] {
+        int32_t keys {N * Partial};
+        for (int32_t line {2}; line < N; line++)
+            keys *= Full;
+        return keys;
+    }()};
+
+    static int32_t last(int32_t blank) {
+        return blank == N - 1 ? N - 2 : N - 1;
+    }
+
+    static uint32_t key(const std::array<int32_t, N>& lines, int32_t blank) {
+        uint32_t key {static_cast<uint32_t>(blank * Partial + Rank[lines[blank]])};
+        for (int32_t line {0}; line < N; line++) {
+            if (line != blank && line != last(blank))
+                key = key * Full + Rank[lines[line]];
+        }
+
+        return key;
+    }
+
+    // Distance of every configuration key, Unknown for keys no board has.
+    // Built with a breadth-first search on first use.
+    static const std::array<uint8_t, Keys>& distances();
+
+    uint32_t solve(const Game& game) const;
+    uint32_t update(const Game& game, Move move, uint32_t h) const;
+
+private:
+    // A 4x4 board packs the two cells of a line half into a byte, so counts
+    // go a byte at a time: what it adds to its row's counts, and to the
+    // counts of its two columns in separate 16-bit halves.
+    static constexpr std::array<int32_t, 256> RowPair = [] {
+        std::array<int32_t, 256> digits {};
+        for (int32_t pair {0}; pair < 256; pair++) {
+            for (int32_t tile : {pair & 0xF, pair >> 4}) {
+                if (tile != 0 && tile < Game::Size)
+                    digits[pair] += Power[Game::row(tile - 1)];
+            }
+        }
+        return digits;
+    }();
+
+    static constexpr std::array<uint32_t, 256> ColPair = [] {
+        std::array<uint32_t, 256> digits {};
+        for (int32_t pair {0}; pair < 256; pair++) {
+            for (int32_t half {0}; half < 2; half++) {
+                int32_t tile {(pair >> (4 * half)) & 0xF};
+                if (tile != 0 && tile < Game::Size)
+                    digits[pair] += static_cast<uint32_t>(Power[Game::col(tile - 1)]) << (16 * half);
+            }
+        }
+        return digits;
+    }();
+
+    static std::array<int32_t, N> rows(const Game& game);
+    static std::array<int32_t, N> cols(const Game& game);
+
+    const std::array<uint8_t, Keys>& _distances {distances()};
+};
+
+template <int32_t N>
+inline std::array<int32_t, N> BasicWalkingDistance<N>::rows(const Game& game) {
+    std::array<int32_t, N> lines {};
+    if constexpr (N == 4) {
+        uint64_t bits {game.board().bits()};
+        for (int32_t row {0}; row < N; row++)
+            lines[row] = RowPair[(bits >> (16 * row)) & 0xFF] + RowPair[(bits >> (16 * row + 8)) & 0xFF];
+    } else {
+        for (int32_t cell {0}; cell < Game::Size; cell++) {
+            int32_t tile {game.get(cell)};
+            if (tile != 0)
+                lines[Game::row(cell)] += Power[Game::row(tile - 1)];
+        }
+    }
+
+    return lines;
+}
+
+template <int32_t N>
+inline std::array<int32_t, N> BasicWalkingDistance<N>::cols(const Game& game) {
+    std::array<int32_t, N> lines {};
+    if constexpr (N == 4) {
+        uint64_t bits {game.board().bits()};
+        uint32_t left {0};
+        uint32_t right {0};
+        for (int32_t row {0}; row < N; row++) {
+            left += ColPair[(bits >> (16 * row)) & 0xFF];
+            right += ColPair[(bits >> (16 * row + 8)) & 0xFF];
+        }
+
+        lines = {
+            static_cast<int32_t>(left & 0xFFFF),
+            static_cast<int32_t>(left >> 16),
+            static_cast<int32_t>(right & 0xFFFF),
+            static_cast<int32_t>(right >> 16),
+        };
+    } else {
+        for (int32_t cell {0}; cell < Game::Size; cell++) {
+            int32_t tile {game.get(cell)};
+            if (tile != 0)
+                lines[Game::col(cell)] += Power[Game::col(tile - 1)];
+        }
+    }
+
+    return lines;
+}
+
+// Only the counts along the move change: the tile left the line of the new
+// blank for the line of the old one. The old key follows from the new
+// counts by moving its digit back. The new counts themselves have to be
+// recounted from the board, since only the estimate is passed down from the
+// parent; on 4x4 that is eight byte lookups.
+template <int32_t N>
+inline uint32_t BasicWalkingDistance<N>::update(const Game& game, Move move, uint32_t h) const {
+    int32_t from {game.blank()};
+    int32_t to {this->movedTo(game, move)};
+    int32_t tile {game.get(to)};
+
+    bool vertical {Game::col(from) == Game::col(to)};
+    auto line = [&](int32_t cell) {
+        return vertical ? Game::row(cell) : Game::col(cell);
+    };
+
+    std::array<int32_t, N> lines {vertical ? rows(game) : cols(game)};
+    uint32_t after {_distances[key(lines, line(from))]};
+
+    lines[line(to)] -= Power[line(tile - 1)];
+    lines[line(from)] += Power[line(tile - 1)];
+    uint32_t before {_distances[key(lines, line(to))]};
+
+    return h - before + after;
+}
+
+// Largest estimate of several admissible heuristics, which is admissible as
+// well. Components run in the order given, cheapest first. The bounded
+// update() stops as soon as the estimate reaches the bound at which the
+// search prunes the node, so the costly components only run on nodes the
+// cheap ones cannot cut off.
+template <int32_t N>
+class BasicMaxHeuristic final : public BasicHeuristic<N> {
+public:
+    using Game = BasicGame<N>;
+    using Heuristic = BasicHeuristic<N>;
+
+    struct Stats {
+        // Times the component ran.
+        uint64_t evaluations;
+        // Times it gave a larger estimate than the components before it.
+        uint64_t raised;
+        // Times its estimate reached the bound, skipping the rest.
+        uint64_t cutoffs;
+    };
+
+    explicit BasicMaxHeuristic(std::vector<std::unique_ptr<Heuristic>> components) :
+        _components(std::move(components)),
+        _counters(_components.size()) {}
+
+    uint32_t solve(const Game& game) const {
+        return evaluate(game, std::numeric_limits<uint32_t>::max());
+    }
+
+    uint32_t update(const Game& game, Move move, uint32_t h) const {
+        (void)move;
+        (void)h;
+        return solve(game);
+    }
+
+    // Estimate that may stop short of the maximum once it reaches bound.
+    uint32_t update(const Game& game, Move move, uint32_t h, uint32_t bound) const {
+        (void)move;
+        (void)h;
+        return evaluate(game, bound);
+    }
+
+    size_t size() const {
+        return _components.size();
+    }
+
+    const Heuristic& component(size_t index) const {
+        return *_components[index];
+    }
+
+    Stats stats(size_t index) const;
+    void resetStats();
+
+private:
+    struct Counters {
+        std::atomic<uint64_t> evaluations {0};
+        std::atomic<uint64_t> raised {0};
+        std::atomic<uint64_t> cutoffs {0};
+    };
+
+    uint32_t evaluate(const Game& game, uint32_t bound) const;
+
+    std::vector<std::unique_ptr<Heuristic>> _components;
+    // Counted with relaxed atomics so searches on several threads can share
+    // one heuristic.
+    mutable std::vector<Counters> _counters;
+};
+
+template <int32_t N>
+inline uint32_t BasicMaxHeuristic<N>::evaluate(const Game& game, uint32_t bound) const {
+    uint32_t estimate {0};
+    for (size_t i {0}; i < _components.size(); i++) {
+        uint32_t h {_components[i]->solve(game)};
+        _counters[i].evaluations.fetch_add(1, std::memory_order_relaxed);
+
+        if (h > estimate) {
+            estimate = h;
+            _counters[i].raised.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (estimate >= bound) {
+            _counters[i].cutoffs.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+    }
+
+    return estimate;
+}
+
+enum class HeuristicKind {
+    MANHATTAN_DISTANCE,
+    LINEAR_CONFLICT,
+    WALKING_DISTANCE,
+    PATTERN_DATABASE,
+    REFLECTED_PATTERN_DATABASE,
+    ALTERNATING_PATTERN_DATABASE,
+    MAXIMUM,
+};
+
+inline constexpr const char* HeuristicNames[] {
+    "Manhattan",
+    "Linear conflict",
+    "Walking distance",
+    "Pattern database",
+    "Reflected pattern database",
+    "Alternating pattern database",
+    "Maximum",
+};
+
+// Pattern databases are only shipped for 4x4 boards, other sizes get the
+// best heuristic they support in their place. The maximum combines Manhattan
+// distance with walking distance and pattern databases where available.
+// Databases missing on disk are built first, which a stop requested on the
+// token cuts short; nullptr is returned then.
+
+template <int32_t N>
+std::unique_ptr<BasicHeuristic<N>> makeHeuristic(HeuristicKind kind, std::stop_token stop = {});
+
+using Heuristic = BasicHeuristic<4>;
+using ManhattanDistance = BasicManhattanDistance<4>;
+using LinearConflict = BasicLinearConflict<4>;
+using WalkingDistance = BasicWalkingDistance<4>;
+using MaxHeuristic = BasicMaxHeuristic<4>;
@@ -0,0 +1,108 @@
+#include "Kernels.hh"
+#include "spdlog/spdlog.h"
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// Compares the board kernels against the std::vector<int> + std::equal
+// representation the boards used to have, on random 5x5 boards.
+
+namespace {
+
+constexpr int32_t Cells {25};
+constexpr int32_t Boards {4096};
+constexpr int32_t Rounds {2000};
+
+template <typename F>
+void measure(const char* name, F&& body) {
+    auto start = std::chrono::steady_clock::now();
+
+    uint64_t sink {0};
+    for (int32_t round {0}; round < Rounds; round++)
+        sink += body();
+
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+    spdlog::info("{:<24} {:6.2f} ns/board (checksum {})", name, elapsed.count() / (Rounds * Boards), sink);
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng {42};
+
+    std::vector<std::vector<int>> vectors(Boards, std::vector<int>(Cells));
+    std::vector<uint8_t> blocks(Boards * BoardKernels::Block);
+    std::vector<uint8_t> goal(BoardKernels::Block);
+
+    for (int32_t i {0}; i < Cells; i++)
+        goal[i] = static_cast<uint8_t>((i + 1) % Cells);
+
+    for (int32_t b {0}; b < Boards; b++) {
+        // Odd boards copy their predecessor and shuffle only the last cells,
+        // so comparisons do not bail out on the first cell.
+        if (b % 2 == 1) {
+            vectors[b] = vectors[b - 1];
+            std::shuffle(vectors[b].begin() + Cells - 2, vectors[b].end(), rng);
+        } else {
+            std::iota(vectors[b].begin(), vectors[b].end(), 0);
+            std::shuffle(vectors[b].begin(), vectors[b].end(), rng);
+        }
+
+        for (int32_t i {0}; i < Cells; i++)
+            blocks[b * BoardKernels::Block + i] = static_cast<uint8_t>(vectors[b][i]);
+    }
+
+    spdlog::info("Selected kernels: {}", boardKernels().name);
+
+    measure("vector equal", [&] {
+        uint64_t count {0};
+        for (int32_t b {1}; b < Boards; b++)
+            count += std::equal(vectors[b].begin(), vectors[b].end(), vectors[b - 1].begin());
+        return count;
+    });
+
+    measure("vector misplaced", [&] {
+        uint64_t count {0};
+        for (int32_t b {0}; b < Boards; b++) {
+            for (int32_t i {0}; i < Cells; i++)
+                count += vectors[b][i] != goal[i];
+        }
+        return count;
+    });
+
+    std::vector<const BoardKernels*> kernels {&scalarKernels};
+#if defined(__x86_64__) || defined(_M_X64)
+    kernels.push_back(&sse2Kernels);
+    if (&boardKernels() == &avx2Kernels)
+        kernels.push_back(&avx2Kernels);
+#endif
+
+    for (const BoardKernels* k : kernels) {
+        std::string prefix {k->name};
+
+        measure((prefix + " equal").c_str(), [&] {
+            uint64_t count {0};
+            for (int32_t b {1}; b < Boards; b++)
+                count += k->equal(&blocks[b * BoardKernels::Block], &blocks[(b - 1) * BoardKernels::Block]);
+            return count;
+        });
+
+        measure((prefix + " hash").c_str(), [&] {
+            uint64_t h {0};
+            for (int32_t b {0}; b < Boards; b++)
+                h ^= k->hash(&blocks[b * BoardKernels::Block]);
+            return h;
+        });
+
+        measure((prefix + " misplaced").c_str(), [&] {
+            uint64_t count {0};
+            for (int32_t b {0}; b < Boards; b++)
+                count += k->misplaced(&blocks[b * BoardKernels::Block], goal.data());
+            return count;
+        });
+    }
+
+    return 0;
+}
@@ -0,0 +1,172 @@
+#include "Kernels.hh"
+#include <bit>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+        #define AVX2_TARGET
+    #else
+        #define AVX2_TARGET __attribute__((target("avx2")))
+    #endif
+#endif
+
+namespace {
+
+constexpr uint64_t HashKeys[4] {
+    0x9E3779B97F4A7C15ULL,
+    0xBF58476D1CE4E5B9ULL,
+    0x94D049BB133111EBULL,
+    0xD6E8FEB86659FD93ULL,
+};
+
+// All kernels reduce each 64-bit lane to (lo * hi of lane ^ key) + lane and
+// share this final mix, so every implementation returns the same hash.
+uint64_t combine(const uint64_t* acc) {
+    uint64_t h {acc[0] + std::rotl(acc[1], 16) + std::rotl(acc[2], 32) + std::rotl(acc[3], 48)};
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    return h ^ (h >> 31);
+}
+
+uint64_t load(const uint8_t* cells, int32_t lane) {
+    uint64_t value;
+    std::memcpy(&value, cells + lane * 8, sizeof(value));
+    return value;
+}
+
+bool scalarEqual(const uint8_t* a, const uint8_t* b) {
+    uint64_t diff {0};
+    for (int32_t i {0}; i < 4; i++)
+        diff |= load(a, i) ^ load(b, i);
+
+    return diff == 0;
+}
+
+uint64_t scalarHash(const uint8_t* cells) {
+    uint64_t acc[4];
+    for (int32_t i {0}; i < 4; i++) {
+        uint64_t lane {load(cells, i)};
+        uint64_t v {lane ^ HashKeys[i]};
+        acc[i] = (v & 0xFFFFFFFF) * (v >> 32) + lane;
+    }
+
+    return combine(acc);
+}
+
+// Counts non-zero bytes of a ^ b eight at a time.
+int32_t scalarMisplaced(const uint8_t* cells, const uint8_t* goal) {
+    constexpr uint64_t low {0x7F7F7F7F7F7F7F7FULL};
+
+    int32_t count {0};
+    for (int32_t i {0}; i < 4; i++) {
+        uint64_t x {load(cells, i) ^ load(goal, i)};
+        count += std::popcount((((x & low) + low) | x) & ~low);
+    }
+
+    return count;
+}
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+bool sse2Equal(const uint8_t* a, const uint8_t* b) {
+    __m128i lo {_mm_cmpeq_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(a)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(b))
+    )};
+    __m128i hi {_mm_cmpeq_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + 16)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + 16))
+    )};
+    return _mm_movemask_epi8(_mm_and_si128(lo, hi)) == 0xFFFF;
+}
+
+uint64_t sse2Hash(const uint8_t* cells) {
+    alignas(16) uint64_t acc[4];
+    for (int32_t i {0}; i < 2; i++) {
+        __m128i lane {_mm_loadu_si128(reinterpret_cast<const __m128i*>(cells + i * 16))};
+        __m128i v {_mm_xor_si128(lane, _mm_loadu_si128(reinterpret_cast<const __m128i*>(HashKeys + i * 2)))};
+        __m128i product {_mm_mul_epu32(v, _mm_srli_epi64(v, 32))};
+        _mm_store_si128(reinterpret_cast<__m128i*>(acc + i * 2), _mm_add_epi64(product, lane));
+    }
+
+    return combine(acc);
+}
+
+int32_t sse2Misplaced(const uint8_t* cells, const uint8_t* goal) {
+    int32_t count {0};
+    for (int32_t i {0}; i < 2; i++) {
+        __m128i equal {_mm_cmpeq_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(cells + i * 16)),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(goal + i * 16))
+        )};
+        count += 16 - std::popcount(static_cast<uint32_t>(_mm_movemask_epi8(equal)));
+    }
+
+    return count;
+}
+
+AVX2_TARGET bool avx2Equal(const uint8_t* a, const uint8_t* b) {
+    __m256i equal {_mm256_cmpeq_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b))
+    )};
+    return _mm256_movemask_epi8(equal) == -1;
+}
+
+AVX2_TARGET uint64_t avx2Hash(const uint8_t* cells) {
+    alignas(32) uint64_t acc[4];
+    __m256i lane {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(cells))};
+    __m256i v {_mm256_xor_si256(lane, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(HashKeys)))};
+    __m256i product {_mm256_mul_epu32(v, _mm256_srli_epi64(v, 32))};
+    _mm256_store_si256(reinterpret_cast<__m256i*>(acc), _mm256_add_epi64(product, lane));
+
+    return combine(acc);
+}
+
+AVX2_TARGET int32_t avx2Misplaced(const uint8_t* cells, const uint8_t* goal) {
+    __m256i equal {_mm256_cmpeq_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cells)),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(goal))
+    )};
+    return 32 - std::popcount(static_cast<uint32_t>(_mm256_movemask_epi8(equal)));
+}
+
+bool supportsAvx2() {
+    #if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+
+    __cpuid(info, 1);
+    bool osxsave {(info[2] & (1 << 27)) != 0};
+    if (!osxsave || (_xgetbv(0) & 6) != 6)
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+    #else
+    return __builtin_cpu_supports("avx2");
+    #endif
+}
+
+#endif
+
+} // namespace
+
+const BoardKernels scalarKernels {"scalar", scalarEqual, scalarHash, scalarMisplaced};
+
+#if defined(__x86_64__) || defined(_M_X64)
+const BoardKernels sse2Kernels {"sse2", sse2Equal, sse2Hash, sse2Misplaced};
+const BoardKernels avx2Kernels {"avx2", avx2Equal, avx2Hash, avx2Misplaced};
+#endif
+
+const BoardKernels& boardKernels() {
+#if defined(__x86_64__) || defined(_M_X64)
+    static const BoardKernels& kernels {supportsAvx2() ? avx2Kernels : sse2Kernels};
+    return kernels;
+#else
+    return scalarKernels;
+#endif
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+// Board kernels over a 32-byte block of cells, one byte per cell, with the
+// unused tail zeroed. 5x5 boards are stored this way; 4x4 boards fit a single
+// word and never need them.
+struct BoardKernels {
+    static constexpr int32_t Block {32};
+
+    const char* name;
+    bool (*equal)(const uint8_t* a, const uint8_t* b);
+    uint64_t (*hash)(const uint8_t* cells);
+    int32_t (*misplaced)(const uint8_t* cells, const uint8_t* goal);
+};
+
+extern const BoardKernels scalarKernels;
+#if defined(__x86_64__) || defined(_M_X64)
+extern const BoardKernels sse2Kernels;
+extern const BoardKernels avx2Kernels;
+#endif
+
+// Fastest kernels the running CPU supports, picked once on first use.
+const BoardKernels& boardKernels();
@@ -0,0 +1,104 @@
+#include "MappedFile.hh"
+
+#ifdef _WIN32
+    #include <Windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+std::shared_ptr<const MappedFile> MappedFile::open(const std::filesystem::path& path) {
+    std::shared_ptr<MappedFile> file {new MappedFile()};
+
+    file->_file = CreateFileW(
+        path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+    );
+    if (file->_file == INVALID_HANDLE_VALUE) {
+        file->_file = nullptr;
+        return nullptr;
+    }
+
+    LARGE_INTEGER size {};
+    if (!GetFileSizeEx(file->_file, &size) || size.QuadPart == 0)
+        return nullptr;
+
+    file->_mapping = CreateFileMappingW(file->_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (file->_mapping == nullptr)
+        return nullptr;
+
+    file->_data = static_cast<const uint8_t*>(MapViewOfFile(file->_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (file->_data == nullptr)
+        return nullptr;
+
+    file->_size = static_cast<size_t>(size.QuadPart);
+    return file;
+}
+
+MappedFile::~MappedFile() {
+    if (_data != nullptr)
+        UnmapViewOfFile(_data);
+    if (_mapping != nullptr)
+        CloseHandle(_mapping);
+    if (_file != nullptr)
+        CloseHandle(_file);
+}
+
+void MappedFile::adviseRandom() const {}
+
+void MappedFile::adviseWillNeed() const {
+    WIN32_MEMORY_RANGE_ENTRY range {const_cast<uint8_t*>(_data), _size};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+#else
+
+std::shared_ptr<const MappedFile> MappedFile::open(const std::filesystem::path& path) {
+    int descriptor {::open(path.c_str(), O_RDONLY)};
+    if (descriptor < 0)
+        return nullptr;
+
+    struct stat info {};
+    if (fstat(descriptor, &info) != 0 || info.st_size == 0) {
+        close(descriptor);
+        return nullptr;
+    }
+
+    size_t size {static_cast<size_t>(info.st_size)};
+    void* data {mmap(nullptr, size, PROT_READ, MAP_SHARED, descriptor, 0)};
+    close(descriptor);
+
+    if (data == MAP_FAILED)
+        return nullptr;
+
+    std::shared_ptr<MappedFile> file {new MappedFile()};
+    file->_data = static_cast<const uint8_t*>(data);
+    file->_size = size;
+    return file;
+}
+
+MappedFile::~MappedFile() {
+    if (_data != nullptr)
+        munmap(const_cast<uint8_t*>(_data), _size);
+}
+
+void MappedFile::adviseRandom() const {
+    madvise(const_cast<uint8_t*>(_data), _size, MADV_RANDOM);
+}
+
+void MappedFile::adviseWillNeed() const {
+    madvise(const_cast<uint8_t*>(_data), _size, MADV_WILLNEED);
+}
+
+#endif
+
+void MappedFile::touch() const {
+    constexpr size_t Page {4096};
+
+    volatile uint8_t sink {0};
+    for (size_t offset {0}; offset < _size; offset += Page)
+        sink = sink + _data[offset];
+}
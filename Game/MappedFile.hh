@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+// Read-only shared mapping of a whole file. Pages are read in lazily by the
+// first access and live in the page cache, so every process mapping the same
+// file shares one physical copy.
+class MappedFile {
+public:
+    static std::shared_ptr<const MappedFile> open(const std::filesystem::path& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    const uint8_t* data() const {
+        return _data;
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+    // Lookups jump around the file, so read-ahead only wastes I/O.
+    void adviseRandom() const;
+
+    // Asks the kernel to start reading the whole file in the background.
+    void adviseWillNeed() const;
+
+    // Faults every page in now, one read per page.
+    void touch() const;
+
+private:
+    MappedFile() = default;
+
+    const uint8_t* _data {nullptr};
+    size_t _size {0};
+#ifdef _WIN32
+    void* _file {nullptr};
+    void* _mapping {nullptr};
+#endif
+};
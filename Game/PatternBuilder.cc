@@ -0,0 +1,80 @@
+#include "PatternDatabase.hh"
+#include "spdlog/spdlog.h"
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <string_view>
+
+// Builds the pattern databases of a 15-puzzle partition and writes them where
+// patternDatabases() looks for them, optionally compressed.
+//
+//     pdb_builder <663|78> [directory] [threads] [byte|nibble|mod3]
+//
+// byte and nibble tables are exact. mod3 tables are the smallest but hold a
+// weaker consistent copy of the distances, and are only used for plain
+// pattern database searches; see PatternEncoding.
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        spdlog::error("Usage: {} <663|78> [directory] [threads] [byte|nibble|mod3]", argv[0]);
+        return 1;
+    }
+
+    std::string_view name {argv[1]};
+    Partition partition {};
+    if (name == "663") {
+        partition = Partition::SIX_SIX_THREE;
+    } else if (name == "78") {
+        partition = Partition::SEVEN_EIGHT;
+    } else {
+        spdlog::error("Unknown partition {}", name);
+        return 1;
+    }
+
+    std::filesystem::path directory {argc > 2 ? argv[2] : PatternDirectory};
+    int32_t threads {static_cast<int32_t>(std::thread::hardware_concurrency())};
+    if (argc > 3) {
+        std::string_view count {argv[3]};
+        auto [end, error] = std::from_chars(count.data(), count.data() + count.size(), threads);
+        if (error != std::errc {} || end != count.data() + count.size() || threads < 1) {
+            spdlog::error("Usage: {} <663|78> [directory] [threads] [byte|nibble|mod3]", argv[0]);
+            return 1;
+        }
+    }
+
+    std::string_view format {argc > 4 ? argv[4] : "byte"};
+    PatternEncoding encoding {};
+    if (format == "byte") {
+        encoding = PatternEncoding::BYTE;
+    } else if (format == "nibble") {
+        encoding = PatternEncoding::NIBBLE;
+    } else if (format == "mod3") {
+        encoding = PatternEncoding::MOD3;
+    } else {
+        spdlog::error("Unknown encoding {}", format);
+        return 1;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        spdlog::error("Unable to create {}: {}", directory.string(), error.message());
+        return 1;
+    }
+
+    for (std::vector<int8_t>& tiles : partitionTiles(partition)) {
+        auto path = directory / PatternDatabase::fileName(tiles, encoding);
+        auto start = std::chrono::steady_clock::now();
+
+        // Byte tables are saved as built; encoding would copy the whole table.
+        auto database = PatternDatabase::build(std::move(tiles), threads);
+        if (database && encoding != PatternEncoding::BYTE)
+            database = database->encode(encoding);
+        if (!database || !database->save(path))
+            return 1;
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        spdlog::info("Wrote {} ({} entries) in {}ms", path.string(), database->size(), elapsed.count());
+    }
+
+    return 0;
+}
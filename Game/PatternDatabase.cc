@@ -0,0 +1,594 @@
+#include "PatternDatabase.hh"
+#include "MappedFile.hh"
+#include "Permutation.hh"
+#include "spdlog/spdlog.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <utility>
+
+std::vector<std::vector<int8_t>> partitionTiles(Partition partition) {
+    switch (partition) {
+    case Partition::SEVEN_EIGHT:
+        return {{1, 2, 3, 4, 5, 6, 7, 8}, {9, 10, 11, 12, 13, 14, 15}};
+    case Partition::SIX_SIX_THREE:
+    default:
+        return {{1, 5, 6, 9, 10, 13}, {7, 8, 11, 12, 14, 15}, {2, 3, 4}};
+    }
+}
+
+template <int32_t N>
+uint64_t BasicPatternDatabase<N>::goal() const {
+    std::array<int8_t, Game::Size> positions {};
+    for (size_t i {0}; i < _tiles.size(); i++)
+        positions[i] = static_cast<int8_t>(_tiles[i] - 1);
+
+    return rankPositions(std::span {positions.data(), _tiles.size()}, Game::Size);
+}
+
+template <int32_t N>
+uint32_t BasicPatternDatabase<N>::lookup(std::span<const int8_t> where) const {
+    uint64_t rank {index(where)};
+
+    switch (_encoding) {
+    case PatternEncoding::NIBBLE: {
+        uint32_t distance {0};
+        for (int8_t tile : _tiles)
+            distance += BasicManhattanDistance<N>::Distance[tile][where[tile]];
+
+        return distance + 2 * at(rank);
+    }
+    case PatternEncoding::MOD3: {
+        // Every placement but the goal has a neighbour one move closer, the
+        // only one whose residue is one less. A damaged table could send the
+        // walk in circles, hence the cap.
+        std::array<int8_t, Game::Size> positions {};
+        std::span<int8_t> placement {positions.data(), _tiles.size()};
+        unrankPositions(rank, placement, Game::Size);
+
+        uint32_t occupied {0};
+        for (int8_t cell : placement)
+            occupied |= 1U << cell;
+
+        uint64_t target {goal()};
+        uint32_t distance {0};
+        for (; rank != target && distance < Unknown; distance++) {
+            uint32_t closer {(at(rank) + 2) % 3};
+            bool found {false};
+
+            for (size_t i {0}; i < placement.size() && !found; i++) {
+                int32_t cell {positions[i]};
+
+                for (uint32_t free {Game::Adjacent[cell] & ~occupied}; free != 0 && !found; free &= free - 1) {
+                    positions[i] = static_cast<int8_t>(std::countr_zero(free));
+                    uint64_t moved {rankPositions(placement, Game::Size)};
+
+                    if (at(moved) == closer) {
+                        occupied ^= (1U << cell) | (1U << positions[i]);
+                        rank = moved;
+                        found = true;
+                    } else {
+                        positions[i] = static_cast<int8_t>(cell);
+                    }
+                }
+            }
+
+            if (!found)
+                break;
+        }
+
+        return distance;
+    }
+    case PatternEncoding::BYTE:
+    default:
+        return at(rank);
+    }
+}
+
+namespace {
+
+// Cells the blank reaches from blank without pushing an occupied cell.
+template <int32_t N>
+uint32_t region(uint32_t occupied, int32_t blank) {
+    uint32_t cells {1U << blank};
+    uint32_t todo {cells};
+    while (todo != 0) {
+        int32_t cell {std::countr_zero(todo)};
+        todo &= todo - 1;
+
+        uint32_t around {BasicGame<N>::Adjacent[cell] & ~occupied & ~cells};
+        cells |= around;
+        todo |= around;
+    }
+
+    return cells;
+}
+
+template <int32_t N>
+void mark(std::vector<uint64_t>& set, uint64_t rank, uint32_t cells) {
+    for (; cells != 0; cells &= cells - 1) {
+        uint64_t state {rank * BasicGame<N>::Size + std::countr_zero(cells)};
+        std::atomic_ref {set[state >> 6]}.fetch_or(uint64_t {1} << (state & 63), std::memory_order_relaxed);
+    }
+}
+
+bool isSet(std::vector<uint64_t>& set, uint64_t state) {
+    return (std::atomic_ref {set[state >> 6]}.load(std::memory_order_relaxed) >> (state & 63)) & 1;
+}
+
+} // namespace
+
+uint64_t patternChecksum(std::span<const uint8_t> data) {
+    constexpr uint64_t prime {0x100000001B3ULL};
+
+    uint64_t hash {0xCBF29CE484222325ULL};
+    size_t i {0};
+    for (; i + 8 <= data.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data.data() + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+    }
+
+    for (; i < data.size(); i++)
+        hash = (hash ^ data[i]) * prime;
+
+    return hash;
+}
+
+uint64_t patternStorage(PatternEncoding encoding, uint64_t entries) {
+    switch (encoding) {
+    case PatternEncoding::NIBBLE:
+        return (entries + 1) / 2;
+    case PatternEncoding::MOD3:
+        return (entries + 3) / 4;
+    case PatternEncoding::BYTE:
+    default:
+        return entries;
+    }
+}
+
+// Breadth-first search over (pattern placement, blank cell) pairs, one layer
+// per pattern move. Sliding another tile is free, so every state stands for
+// the whole region the blank can reach without touching a pattern tile, and
+// regions are marked and expanded at once. A placement's distance is the
+// first layer that reaches it with any blank cell.
+//
+// Threads take chunks of the frontier bitset from a shared cursor. Bitsets
+// are updated with atomic or/and and distances with atomic byte stores, so
+// two threads reaching the same state only duplicate work.
+// A stop request is checked between chunks, so the layer being expanded ends
+// early and the table is dropped.
+template <int32_t N>
+std::optional<BasicPatternDatabase<N>> BasicPatternDatabase<N>::build(
+    std::vector<int8_t> tiles,
+    int32_t threads,
+    std::stop_token stop
+) {
+    int32_t count {static_cast<int32_t>(tiles.size())};
+    uint64_t entries {arrangements(Game::Size, count)};
+    uint64_t words {(entries * Game::Size + 63) / 64};
+
+    auto table = std::make_shared<std::vector<uint8_t>>(entries, Unknown);
+    uint8_t* distances {table->data()};
+    BasicPatternDatabase database {std::move(tiles), PatternEncoding::BYTE, entries, table, *table};
+
+    std::vector<uint64_t> visited(words);
+    std::vector<uint64_t> frontier(words);
+    std::vector<uint64_t> next(words);
+
+    uint32_t occupied {0};
+    for (int8_t tile : database._tiles)
+        occupied |= 1U << (tile - 1);
+
+    uint64_t goal {database.goal()};
+    uint32_t cells {region<N>(occupied, Game::Size - 1)};
+    mark<N>(visited, goal, cells);
+    mark<N>(frontier, goal, cells);
+    distances[goal] = 0;
+
+    threads = std::max(threads, 1);
+    constexpr size_t Chunk {4096};
+
+    for (uint8_t depth {0}; std::any_of(frontier.begin(), frontier.end(), [](uint64_t w) { return w != 0; });
+         depth++) {
+        std::atomic<size_t> cursor {0};
+        std::vector<std::thread> workers;
+
+        for (int32_t t {0}; t < threads; t++) {
+            workers.emplace_back([&] {
+                for (size_t begin {cursor.fetch_add(Chunk)}; begin < words && !stop.stop_requested();
+                     begin = cursor.fetch_add(Chunk))
+                    database.expand(visited, frontier, next, distances, begin, std::min(begin + Chunk, words), depth);
+            });
+        }
+
+        for (std::thread& worker : workers)
+            worker.join();
+
+        if (stop.stop_requested()) {
+            spdlog::info("Pattern {}: stopped at layer {}", fileName(database._tiles), depth);
+            return std::nullopt;
+        }
+
+        spdlog::info("Pattern {}: layer {} done", fileName(database._tiles), depth);
+        std::swap(frontier, next);
+    }
+
+    return database;
+}
+
+template <int32_t N>
+void BasicPatternDatabase<N>::expand(
+    std::vector<uint64_t>& visited,
+    std::vector<uint64_t>& frontier,
+    std::vector<uint64_t>& next,
+    uint8_t* distances,
+    size_t begin,
+    size_t end,
+    uint8_t depth
+) const {
+    int32_t count {static_cast<int32_t>(_tiles.size())};
+    std::array<int8_t, Game::Size> positions {};
+    std::span<int8_t> placement {positions.data(), static_cast<size_t>(count)};
+
+    for (size_t word {begin}; word < end; word++) {
+        std::atomic_ref pending {frontier[word]};
+
+        for (uint64_t bits {pending.load(std::memory_order_relaxed)}; bits != 0;
+             bits = pending.load(std::memory_order_relaxed)) {
+            uint64_t state {word * 64 + std::countr_zero(bits)};
+            uint64_t rank {state / Game::Size};
+
+            unrankPositions(rank, placement, Game::Size);
+            std::array<int8_t, Game::Size> tileAt {};
+            uint32_t occupied {0};
+            for (int32_t i {0}; i < count; i++) {
+                occupied |= 1U << positions[i];
+                tileAt[positions[i]] = static_cast<int8_t>(i);
+            }
+
+            uint32_t cells {region<N>(occupied, static_cast<int32_t>(state % Game::Size))};
+            for (uint32_t rest {cells}; rest != 0; rest &= rest - 1) {
+                uint64_t done {rank * Game::Size + std::countr_zero(rest)};
+                std::atomic_ref {frontier[done >> 6]}.fetch_and(
+                    ~(uint64_t {1} << (done & 63)),
+                    std::memory_order_relaxed
+                );
+            }
+
+            for (uint32_t rest {cells}; rest != 0; rest &= rest - 1) {
+                int32_t blank {std::countr_zero(rest)};
+
+                for (uint32_t pushed {Game::Adjacent[blank] & occupied}; pushed != 0; pushed &= pushed - 1) {
+                    int32_t cell {std::countr_zero(pushed)};
+                    int32_t tile {tileAt[cell]};
+
+                    positions[tile] = static_cast<int8_t>(blank);
+                    uint64_t moved {rankPositions(placement, Game::Size)};
+                    positions[tile] = static_cast<int8_t>(cell);
+
+                    if (isSet(visited, moved * Game::Size + cell))
+                        continue;
+
+                    uint32_t around {region<N>(occupied ^ (1U << cell) ^ (1U << blank), cell)};
+                    mark<N>(visited, moved, around);
+                    mark<N>(next, moved, around);
+
+                    std::atomic_ref distance {distances[moved]};
+                    if (distance.load(std::memory_order_relaxed) == Unknown)
+                        distance.store(static_cast<uint8_t>(depth + 1), std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+}
+
+template <int32_t N>
+std::optional<BasicPatternDatabase<N>> BasicPatternDatabase<N>::load(
+    const std::filesystem::path& path,
+    PatternWarmup warmup,
+    bool verify
+) {
+    auto file = MappedFile::open(path);
+    if (!file)
+        return std::nullopt;
+
+    PatternFileHeader header {};
+    if (file->size() >= sizeof(header))
+        std::memcpy(&header, file->data(), sizeof(header));
+
+    if (header.magic != PatternFileHeader::Magic || header.version != PatternFileHeader::Version
+        || header.dimension != static_cast<uint32_t>(N) || header.tileCount == 0 || header.tileCount >= Game::Size
+        || header.encoding > PatternEncoding::MOD3) {
+        spdlog::error("Invalid pattern database header in {}", path.string());
+        return std::nullopt;
+    }
+
+    // Lookups index tables by tile, so the tiles must be distinct and real.
+    std::vector<int8_t> tiles(header.tiles, header.tiles + header.tileCount);
+    uint32_t seen {0};
+    for (int8_t tile : tiles) {
+        if (tile < 1 || tile >= Game::Size || ((seen >> tile) & 1) != 0) {
+            spdlog::error("Invalid pattern database tiles in {}", path.string());
+            return std::nullopt;
+        }
+        seen |= 1U << tile;
+    }
+
+    uint64_t storage {patternStorage(header.encoding, header.entries)};
+    if (header.entries != arrangements(Game::Size, static_cast<int32_t>(tiles.size()))
+        || file->size() != sizeof(header) + storage) {
+        spdlog::error("Invalid pattern database size in {}", path.string());
+        return std::nullopt;
+    }
+
+    std::span<const uint8_t> data {file->data() + sizeof(header), storage};
+    if (verify && patternChecksum(data) != header.checksum) {
+        spdlog::error("Pattern database {} is corrupted", path.string());
+        return std::nullopt;
+    }
+
+    file->adviseRandom();
+    if (warmup == PatternWarmup::ADVISE)
+        file->adviseWillNeed();
+    else if (warmup == PatternWarmup::TOUCH)
+        file->touch();
+
+    return BasicPatternDatabase {std::move(tiles), header.encoding, header.entries, std::move(file), data};
+}
+
+template <int32_t N>
+bool BasicPatternDatabase<N>::save(const std::filesystem::path& path) const {
+    PatternFileHeader header {};
+    header.magic = PatternFileHeader::Magic;
+    header.version = PatternFileHeader::Version;
+    header.dimension = N;
+    header.tileCount = static_cast<uint32_t>(_tiles.size());
+    header.encoding = _encoding;
+    std::copy(_tiles.begin(), _tiles.end(), header.tiles);
+    header.entries = _entries;
+    header.checksum = patternChecksum(_data);
+
+    // Other processes may have the old file mapped; truncating it under them
+    // would fault their lookups. The new table is written beside it and
+    // renamed over it, so they keep the old inode until they unmap it.
+    std::filesystem::path temporary {path};
+    temporary += ".tmp";
+
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(_data.data()), static_cast<std::streamsize>(_data.size()));
+        file.close();
+
+        if (!file) {
+            spdlog::error("Failed to write pattern database {}", temporary.string());
+            std::error_code error;
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        spdlog::error("Failed to replace pattern database {}: {}", path.string(), error.message());
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+
+    return true;
+}
+
+// The consistent table is found like distances in a graph: the goal keeps 0
+// and each entry is lowered to one more than its smallest neighbour, settling
+// one value per pass over the table.
+template <int32_t N>
+std::optional<BasicPatternDatabase<N>> BasicPatternDatabase<N>::encode(PatternEncoding encoding) const {
+    if (_encoding != PatternEncoding::BYTE) {
+        spdlog::error("Pattern {} is already encoded", fileName(_tiles, _encoding));
+        return std::nullopt;
+    }
+
+    std::array<int8_t, Game::Size> positions {};
+    std::span<int8_t> placement {positions.data(), _tiles.size()};
+    auto table = std::make_shared<std::vector<uint8_t>>(patternStorage(encoding, _entries));
+    std::vector<uint8_t>& data {*table};
+
+    switch (encoding) {
+    case PatternEncoding::NIBBLE:
+        for (uint64_t rank {0}; rank < _entries; rank++) {
+            unrankPositions(rank, placement, Game::Size);
+
+            uint32_t manhattan {0};
+            for (size_t i {0}; i < placement.size(); i++)
+                manhattan += BasicManhattanDistance<N>::Distance[_tiles[i]][positions[i]];
+
+            uint32_t excess {_data[rank] - manhattan};
+            if (_data[rank] < manhattan || excess % 2 != 0 || excess / 2 > 0xF) {
+                spdlog::error("Pattern {} does not fit in nibbles", fileName(_tiles));
+                return std::nullopt;
+            }
+
+            data[rank >> 1] |= static_cast<uint8_t>((excess / 2) << ((rank & 1) * 4));
+        }
+        break;
+    case PatternEncoding::MOD3: {
+        std::vector<uint8_t> consistent(_data.begin(), _data.end());
+        uint8_t deepest {*std::max_element(consistent.begin(), consistent.end())};
+
+        for (uint8_t depth {0}; depth < deepest; depth++) {
+            for (uint64_t rank {0}; rank < _entries; rank++) {
+                if (consistent[rank] != depth)
+                    continue;
+
+                unrankPositions(rank, placement, Game::Size);
+                uint32_t occupied {0};
+                for (int8_t cell : placement)
+                    occupied |= 1U << cell;
+
+                for (size_t i {0}; i < placement.size(); i++) {
+                    int8_t cell {positions[i]};
+
+                    for (uint32_t free {Game::Adjacent[cell] & ~occupied}; free != 0; free &= free - 1) {
+                        positions[i] = static_cast<int8_t>(std::countr_zero(free));
+                        uint8_t& neighbour {consistent[rankPositions(placement, Game::Size)]};
+                        neighbour = std::min(neighbour, static_cast<uint8_t>(depth + 1));
+                    }
+
+                    positions[i] = cell;
+                }
+            }
+        }
+
+        for (uint64_t rank {0}; rank < _entries; rank++)
+            data[rank >> 2] |= static_cast<uint8_t>((consistent[rank] % 3) << ((rank & 3) * 2));
+        break;
+    }
+    case PatternEncoding::BYTE:
+    default:
+        std::copy(_data.begin(), _data.end(), data.begin());
+        break;
+    }
+
+    return BasicPatternDatabase {_tiles, encoding, _entries, table, data};
+}
+
+template <int32_t N>
+std::string BasicPatternDatabase<N>::fileName(std::span<const int8_t> tiles, PatternEncoding encoding) {
+    std::string name {"pattern-" + std::to_string(N)};
+    for (int8_t tile : tiles)
+        name += '-' + std::to_string(tile);
+
+    switch (encoding) {
+    case PatternEncoding::NIBBLE:
+        return name + "-nibble.pdb";
+    case PatternEncoding::MOD3:
+        return name + "-mod3.pdb";
+    case PatternEncoding::BYTE:
+    default:
+        return name + ".pdb";
+    }
+}
+
+template <int32_t N>
+BasicPatternDatabaseHeuristic<N>::BasicPatternDatabaseHeuristic(
+    std::shared_ptr<const std::vector<Database>> databases,
+    PatternReflection reflection
+) :
+    _databases(std::move(databases)),
+    _reflection(reflection) {
+    _pattern.fill(-1);
+    for (size_t i {0}; i < _databases->size(); i++) {
+        for (int8_t tile : (*_databases)[i].tiles())
+            _pattern[tile] = static_cast<int8_t>(i);
+    }
+}
+
+template <int32_t N>
+uint32_t BasicPatternDatabaseHeuristic<N>::solve(const Game& game) const {
+    std::array<int8_t, Game::Size> where {};
+    for (int32_t i {0}; i < Game::Size; i++)
+        where[game.get(i)] = static_cast<int8_t>(i);
+
+    auto sum = [&](const std::array<int8_t, Game::Size>& cells) {
+        uint32_t distance {0};
+        for (const Database& database : *_databases)
+            distance += database.lookup(cells);
+        return distance;
+    };
+
+    auto mirror = [&] {
+        std::array<int8_t, Game::Size> cells {};
+        for (int32_t tile {0}; tile < Game::Size; tile++)
+            cells[Relabel[tile]] = Transpose[where[tile]];
+        return cells;
+    };
+
+    switch (_reflection) {
+    case PatternReflection::MAXIMUM:
+        return std::max(sum(where), sum(mirror()));
+    case PatternReflection::ALTERNATE:
+        return game.hash() & 1 ? sum(mirror()) : sum(where);
+    case PatternReflection::NONE:
+    default:
+        return sum(where);
+    }
+}
+
+// Tables are cached per pattern, exact ones apart from MOD3 ones, so callers
+// that take MOD3 tables and callers that may not share every exact table
+// either of them loaded or built, and no pattern is ever built twice.
+std::shared_ptr<const std::vector<BasicPatternDatabase<4>>> patternDatabases(
+    Partition partition,
+    bool randomAccess,
+    std::stop_token stop
+) {
+    static std::mutex mutex;
+    static std::map<std::vector<int8_t>, BasicPatternDatabase<4>> exact;
+    static std::map<std::vector<int8_t>, BasicPatternDatabase<4>> mod3;
+
+    std::lock_guard lock {mutex};
+
+    std::vector<BasicPatternDatabase<4>> databases;
+    for (std::vector<int8_t>& tiles : partitionTiles(partition)) {
+        if (auto cached = exact.find(tiles); cached != exact.end()) {
+            databases.push_back(cached->second);
+            continue;
+        }
+
+        if (auto cached = mod3.find(tiles); !randomAccess && cached != mod3.end()) {
+            databases.push_back(cached->second);
+            continue;
+        }
+
+        std::vector<PatternEncoding> encodings {PatternEncoding::BYTE, PatternEncoding::NIBBLE};
+        if (!randomAccess)
+            encodings.push_back(PatternEncoding::MOD3);
+
+        std::optional<BasicPatternDatabase<4>> loaded;
+        std::filesystem::path path;
+        for (PatternEncoding encoding : encodings) {
+            path = std::filesystem::path(PatternDirectory) / BasicPatternDatabase<4>::fileName(tiles, encoding);
+            if (std::filesystem::exists(path) && (loaded = BasicPatternDatabase<4>::load(path)))
+                break;
+        }
+
+        if (loaded && loaded->encoding() == PatternEncoding::MOD3) {
+            spdlog::warn(
+                "Falling back to {}: mod3 tables give weaker estimates and slow whole-board lookups",
+                path.string()
+            );
+            mod3.emplace(tiles, *loaded);
+            databases.push_back(std::move(*loaded));
+            continue;
+        }
+
+        if (!loaded) {
+            loaded = BasicPatternDatabase<4>::build(
+                tiles,
+                static_cast<int32_t>(std::thread::hardware_concurrency()),
+                stop
+            );
+            if (!loaded)
+                return nullptr;
+        }
+
+        exact.emplace(tiles, *loaded);
+        databases.push_back(std::move(*loaded));
+    }
+
+    return std::make_shared<const std::vector<BasicPatternDatabase<4>>>(std::move(databases));
+}
+
+template class BasicPatternDatabase<3>;
+template class BasicPatternDatabase<4>;
+template class BasicPatternDatabase<5>;
+
+template class BasicPatternDatabaseHeuristic<3>;
+template class BasicPatternDatabaseHeuristic<4>;
+template class BasicPatternDatabaseHeuristic<5>;
@@ -0,0 +1,285 @@
+#pragma once
+
+#include "Game.hh"
+#include "Heuristic.hh"
+#include "Permutation.hh"
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Disjoint tile partitions shipped for the 15-puzzle.
+enum class Partition { SIX_SIX_THREE, SEVEN_EIGHT };
+
+std::vector<std::vector<int8_t>> partitionTiles(Partition partition);
+
+// Directory patternDatabases() looks in for files written by pdb_builder.
+inline constexpr const char* PatternDirectory {"pdb"};
+
+// How the entries of a database are stored.
+//
+// BYTE keeps every distance in a byte. NIBBLE keeps half the excess of the
+// distance over the Manhattan distance of the pattern tiles, which is always
+// even, in four bits; both are exact. MOD3 keeps residues modulo 3 in two
+// bits, not of the distances but of the largest consistent table below them,
+// in which neighbouring placements differ by at most one. That lowers most
+// estimates, to about what linear conflict gives on 3x3. The change along a
+// move is read off the residues, but a full lookup walks down to the goal
+// placement and is some forty times slower than a byte one, so MOD3 only
+// suits searches that follow moves with update().
+enum class PatternEncoding : uint32_t { BYTE, NIBBLE, MOD3 };
+
+// On-disk layout: this header followed by the encoded entries. Files are
+// written in host byte order.
+struct PatternFileHeader {
+    static constexpr uint32_t Magic {0x31424450}; // "PDB1"
+    static constexpr uint32_t Version {2};
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t dimension;
+    uint32_t tileCount;
+    PatternEncoding encoding;
+    uint32_t reserved;
+    int8_t tiles[24];
+    uint64_t entries;
+    uint64_t checksum;
+};
+
+// Bytes taken by entries stored with encoding.
+uint64_t patternStorage(PatternEncoding encoding, uint64_t entries);
+
+uint64_t patternChecksum(std::span<const uint8_t> data);
+
+// How much of a mapped database to read in before the first lookup.
+enum class PatternWarmup { NONE, ADVISE, TOUCH };
+
+// Exact number of moves of a subset of tiles needed to bring them home,
+// ignoring the other tiles, for every placement of the subset. Moves of the
+// other tiles are free, so the databases of disjoint subsets add up to an
+// admissible estimate. Entries are indexed by rankPositions of the cells the
+// tiles occupy, in the order the tiles are given.
+template <int32_t N>
+class BasicPatternDatabase {
+public:
+    using Game = BasicGame<N>;
+
+    static constexpr uint8_t Unknown {0xFF};
+
+    // Builds the table with a breadth-first search from the goal, every
+    // layer split across the given number of threads. Returns nullopt if a
+    // stop is requested on the token before the table is complete.
+    static std::optional<BasicPatternDatabase> build(
+        std::vector<int8_t> tiles,
+        int32_t threads = static_cast<int32_t>(std::thread::hardware_concurrency()),
+        std::stop_token stop = {}
+    );
+
+    // Maps a table written by save() without copying it; pages come in as
+    // lookups touch them unless a warmup is asked for. Only the header is
+    // checked unless verify is set, since the checksum reads every page.
+    // Returns nullopt if the file is missing or invalid.
+    static std::optional<BasicPatternDatabase> load(
+        const std::filesystem::path& path,
+        PatternWarmup warmup = PatternWarmup::NONE,
+        bool verify = false
+    );
+    // Replaces the file at path as a whole, never rewriting it in place, so
+    // mappings other processes hold stay valid.
+    bool save(const std::filesystem::path& path) const;
+
+    // Copy of a byte table stored with another encoding. MOD3 stores the
+    // largest consistent table below this one, since neighbouring entries of
+    // a blank-aware table may differ by more than a move. Returns nullopt if
+    // this table is already encoded or does not fit the encoding.
+    std::optional<BasicPatternDatabase> encode(PatternEncoding encoding) const;
+
+    static std::string fileName(std::span<const int8_t> tiles, PatternEncoding encoding = PatternEncoding::BYTE);
+
+    const std::vector<int8_t>& tiles() const {
+        return _tiles;
+    }
+
+    PatternEncoding encoding() const {
+        return _encoding;
+    }
+
+    uint64_t size() const {
+        return _entries;
+    }
+
+    // Entry as stored: the distance, half its excess over the Manhattan
+    // distance, or its residue modulo 3.
+    uint32_t at(uint64_t index) const {
+        switch (_encoding) {
+        case PatternEncoding::NIBBLE:
+            return (_data[index >> 1] >> ((index & 1) * 4)) & 0xF;
+        case PatternEncoding::MOD3:
+            return (_data[index >> 2] >> ((index & 3) * 2)) & 0x3;
+        case PatternEncoding::BYTE:
+        default:
+            return _data[index];
+        }
+    }
+
+    // Rank of the pattern given the cell of every tile on the board.
+    uint64_t index(std::span<const int8_t> where) const;
+
+    // Distance of the pattern given the cell of every tile on the board.
+    uint32_t lookup(std::span<const int8_t> where) const;
+
+    // Change of the distance when a single pattern tile moves to a
+    // neighbouring cell. MOD3 tables only need the two residues.
+    int32_t change(std::span<const int8_t> before, std::span<const int8_t> after) const;
+
+private:
+    BasicPatternDatabase(
+        std::vector<int8_t> tiles,
+        PatternEncoding encoding,
+        uint64_t entries,
+        std::shared_ptr<const void> owner,
+        std::span<const uint8_t> data
+    ) :
+        _tiles(std::move(tiles)),
+        _encoding(encoding),
+        _entries(entries),
+        _owner(std::move(owner)),
+        _data(data) {}
+
+    void expand(
+        std::vector<uint64_t>& visited,
+        std::vector<uint64_t>& frontier,
+        std::vector<uint64_t>& next,
+        uint8_t* distances,
+        size_t begin,
+        size_t end,
+        uint8_t depth
+    ) const;
+
+    uint64_t goal() const;
+
+    std::vector<int8_t> _tiles;
+    PatternEncoding _encoding {PatternEncoding::BYTE};
+    uint64_t _entries {0};
+    // Keeps the table alive: a built vector or a file mapping.
+    std::shared_ptr<const void> _owner;
+    std::span<const uint8_t> _data;
+};
+
+template <int32_t N>
+inline uint64_t BasicPatternDatabase<N>::index(std::span<const int8_t> where) const {
+    std::array<int8_t, Game::Size> positions {};
+    for (size_t i {0}; i < _tiles.size(); i++)
+        positions[i] = where[_tiles[i]];
+
+    return rankPositions(std::span {positions.data(), _tiles.size()}, Game::Size);
+}
+
+template <int32_t N>
+inline int32_t BasicPatternDatabase<N>::change(std::span<const int8_t> before, std::span<const int8_t> after) const {
+    switch (_encoding) {
+    case PatternEncoding::MOD3: {
+        constexpr std::array<int32_t, 3> Step {0, 1, -1};
+        return Step[(at(index(after)) + 3 - at(index(before))) % 3];
+    }
+    case PatternEncoding::BYTE:
+        return static_cast<int32_t>(at(index(after))) - static_cast<int32_t>(at(index(before)));
+    case PatternEncoding::NIBBLE:
+    default:
+        return static_cast<int32_t>(lookup(after)) - static_cast<int32_t>(lookup(before));
+    }
+}
+
+// Which boards a pattern database heuristic looks up: the board itself, also
+// its reflection keeping the larger sum, or one of the two picked by the
+// board's hash. Alternating costs a single sum per board, but the estimate
+// jumps between neighbours; the solver's pathmax makes up for it.
+enum class PatternReflection { NONE, MAXIMUM, ALTERNATE };
+
+// Sum of the databases of a disjoint partition. The goal is symmetric about
+// the main diagonal, so the transposed board with its tiles relabelled needs
+// as many moves and can be looked up in the same databases.
+template <int32_t N>
+class BasicPatternDatabaseHeuristic final : public BasicHeuristic<N> {
+public:
+    using Game = BasicGame<N>;
+    using Database = BasicPatternDatabase<N>;
+
+    // Cell mirrored about the main diagonal.
+    static constexpr std::array<int8_t, Game::Size> Transpose = [] {
+        std::array<int8_t, Game::Size> cells {};
+        for (int32_t cell {0}; cell < Game::Size; cell++)
+            cells[cell] = static_cast<int8_t>(Game::col(cell) * N + Game::row(cell));
+        return cells;
+    }();
+
+    // Tile whose goal cell is the mirror of the goal cell of each tile.
+    static constexpr std::array<int8_t, Game::Size> Relabel = [] {
+        std::array<int8_t, Game::Size> tiles {};
+        for (int32_t tile {1}; tile < Game::Size; tile++)
+            tiles[tile] = static_cast<int8_t>(Transpose[tile - 1] + 1);
+        return tiles;
+    }();
+
+    explicit BasicPatternDatabaseHeuristic(
+        std::shared_ptr<const std::vector<Database>> databases,
+        PatternReflection reflection = PatternReflection::NONE
+    );
+
+    uint32_t solve(const Game& game) const;
+    uint32_t update(const Game& game, Move move, uint32_t h) const;
+
+    PatternReflection reflection() const {
+        return _reflection;
+    }
+
+private:
+    std::shared_ptr<const std::vector<Database>> _databases;
+    std::array<int8_t, Game::Size> _pattern {};
+    PatternReflection _reflection {PatternReflection::NONE};
+};
+
+// Only the database holding the moved tile changes its value; moves of tiles
+// outside every pattern are free. Reflected estimates may come from the
+// other sum than the parent's, so they are looked up again.
+template <int32_t N>
+inline uint32_t BasicPatternDatabaseHeuristic<N>::update(const Game& game, Move move, uint32_t h) const {
+    if (_reflection != PatternReflection::NONE)
+        return solve(game);
+
+    int32_t to {this->movedTo(game, move)};
+    int32_t tile {game.get(to)};
+    if (_pattern[tile] < 0)
+        return h;
+
+    std::array<int8_t, Game::Size> where {};
+    for (int32_t i {0}; i < Game::Size; i++)
+        where[game.get(i)] = static_cast<int8_t>(i);
+
+    std::array<int8_t, Game::Size> before {where};
+    before[tile] = static_cast<int8_t>(game.blank());
+
+    return h + (*_databases)[_pattern[tile]].change(before, where);
+}
+
+// Databases of a 15-puzzle partition, shared by every heuristic that asks for
+// them. They are read from PatternDirectory when present and built in memory
+// on first use otherwise. MOD3 files are only taken when nothing else is
+// there, and never for callers looking up whole boards at random, such as
+// reflected lookups or a maximum over several heuristics, and an exact table
+// already in memory always wins over them. Returns nullptr if a stop is
+// requested while a database is being built; tables finished before it are
+// kept for the next call.
+std::shared_ptr<const std::vector<BasicPatternDatabase<4>>> patternDatabases(
+    Partition partition,
+    bool randomAccess = false,
+    std::stop_token stop = {}
+);
+
+using PatternDatabase = BasicPatternDatabase<4>;
+using PatternDatabaseHeuristic = BasicPatternDatabaseHeuristic<4>;
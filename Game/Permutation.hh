@@ -0,0 +1,163 @@
+#pragma once
+
+#include "Game.hh"
+#include <bit>
+#include <cstdint>
+#include <span>
+
+constexpr uint64_t factorial(int32_t n) {
+    uint64_t result {1};
+    for (int32_t i {2}; i <= n; i++)
+        result *= static_cast<uint64_t>(i);
+
+    return result;
+}
+
+// Number of ways to place k distinct tiles on n cells.
+constexpr uint64_t arrangements(int32_t n, int32_t k) {
+    uint64_t result {1};
+    for (int32_t i {0}; i < k; i++)
+        result *= static_cast<uint64_t>(n - i);
+
+    return result;
+}
+
+// Lehmer digit of value among the values not yet marked in used: the number
+// of smaller free values, counted with a single popcount.
+inline int32_t lehmerDigit(uint32_t used, int32_t value) {
+    return value - std::popcount(used & ((1U << value) - 1));
+}
+
+// Inverse of lehmerDigit: the digit-th value not marked in used.
+inline int32_t selectFree(uint32_t used, int32_t digit) {
+    uint32_t free {~used};
+    for (int32_t i {0}; i < digit; i++)
+        free &= free - 1;
+
+    return std::countr_zero(free);
+}
+
+// Dense rank of k distinct cells out of n in [0, arrangements(n, k)). This is
+// the index of a partial permutation, e.g. the cells of a pattern's tiles.
+inline uint64_t rankPositions(std::span<const int8_t> positions, int32_t cells) {
+    uint32_t used {0};
+    uint64_t index {0};
+
+    for (size_t i {0}; i < positions.size(); i++) {
+        index = index * static_cast<uint64_t>(cells - static_cast<int32_t>(i)) + lehmerDigit(used, positions[i]);
+        used |= 1U << positions[i];
+    }
+
+    return index;
+}
+
+inline void unrankPositions(uint64_t index, std::span<int8_t> positions, int32_t cells) {
+    int32_t count {static_cast<int32_t>(positions.size())};
+
+    for (int32_t i {count - 1}; i >= 0; i--) {
+        uint64_t radix {static_cast<uint64_t>(cells - i)};
+        positions[i] = static_cast<int8_t>(index % radix);
+        index /= radix;
+    }
+
+    uint32_t used {0};
+    for (int32_t i {0}; i < count; i++) {
+        positions[i] = static_cast<int8_t>(selectFree(used, positions[i]));
+        used |= 1U << positions[i];
+    }
+}
+
+// Rank of the cells holding the given tiles, in tile order.
+template <int32_t N>
+uint64_t rankPattern(const BasicGame<N>& game, std::span<const int8_t> tiles) {
+    std::array<int8_t, BasicGame<N>::Size> where {};
+    for (int32_t i {0}; i < BasicGame<N>::Size; i++)
+        where[game.get(i)] = static_cast<int8_t>(i);
+
+    std::array<int8_t, BasicGame<N>::Size> positions {};
+    for (size_t i {0}; i < tiles.size(); i++)
+        positions[i] = where[tiles[i]];
+
+    return rankPositions(std::span {positions.data(), tiles.size()}, BasicGame<N>::Size);
+}
+
+// Solvable boards of dimension N. Only boards up to 4x4 have a rank that
+// fits 64 bits.
+template <int32_t N>
+constexpr uint64_t SolvableCount {factorial(N * N) / 2};
+
+// Inversion parity a solvable board needs with the blank at the given cell,
+// see BasicGame::isSolvable.
+template <int32_t N>
+constexpr int32_t solvableParity(int32_t blank) {
+    if constexpr (N % 2 == 0)
+        return BasicGame<N>::row(blank) % 2 == 0 ? 1 : 0;
+    else
+        return 0;
+}
+
+// Dense rank of a solvable board in [0, SolvableCount<N>): the blank cell
+// times (n - 1)! / 2 plus the Lehmer rank of the tiles in reading order. The
+// order of the last two tiles is fixed by the parity the blank cell demands,
+// so their digits are dropped.
+template <int32_t N>
+uint64_t rank(const BasicGame<N>& game) {
+    static_assert(N <= 4, "ranks of larger boards do not fit 64 bits");
+
+    constexpr int32_t tiles {BasicGame<N>::Size - 1};
+
+    uint32_t used {0};
+    uint64_t index {0};
+    int32_t count {0};
+
+    for (int32_t i {0}; i < BasicGame<N>::Size && count < tiles - 2; i++) {
+        int32_t value {game.get(i) - 1};
+        if (value < 0)
+            continue;
+
+        index = index * static_cast<uint64_t>(tiles - count) + lehmerDigit(used, value);
+        used |= 1U << value;
+        count++;
+    }
+
+    return static_cast<uint64_t>(game.blank()) * (factorial(tiles) / 2) + index;
+}
+
+template <int32_t N>
+BasicGame<N> unrank(uint64_t index) {
+    static_assert(N <= 4, "ranks of larger boards do not fit 64 bits");
+
+    constexpr int32_t tiles {BasicGame<N>::Size - 1};
+
+    int32_t blank {static_cast<int32_t>(index / (factorial(tiles) / 2))};
+    index %= factorial(tiles) / 2;
+
+    std::array<int8_t, tiles> sequence {};
+    for (int32_t i {tiles - 3}; i >= 0; i--) {
+        uint64_t radix {static_cast<uint64_t>(tiles - i)};
+        sequence[i] = static_cast<int8_t>(index % radix);
+        index /= radix;
+    }
+
+    // Lehmer digits sum to the inversion count, so the parity is known before
+    // the last two tiles are placed.
+    uint32_t used {0};
+    int32_t parity {0};
+    for (int32_t i {0}; i < tiles - 2; i++) {
+        parity ^= sequence[i] & 1;
+        sequence[i] = static_cast<int8_t>(selectFree(used, sequence[i]));
+        used |= 1U << sequence[i];
+    }
+
+    int32_t low {selectFree(used, 0)};
+    int32_t high {selectFree(used, 1)};
+    bool swap {parity != solvableParity<N>(blank)};
+    sequence[tiles - 2] = static_cast<int8_t>(swap ? high : low);
+    sequence[tiles - 1] = static_cast<int8_t>(swap ? low : high);
+
+    typename BasicGame<N>::Cells cells {};
+    for (int32_t i {0}, tile {0}; i < BasicGame<N>::Size; i++)
+        cells[i] = static_cast<int8_t>(i == blank ? 0 : sequence[tile++] + 1);
+
+    return BasicGame<N> {cells};
+}
@@ -0,0 +1,218 @@
+#include "Generator.hh"
+#include "Heuristic.hh"
+#include "PatternDatabase.hh"
+#include "Permutation.hh"
+#include "Solver.hh"
+#include "spdlog/spdlog.h"
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Checks the 8-puzzle against a breadth-first search over all its solvable
+// boards: ranks round-trip, every heuristic is admissible and its update()
+// agrees with solve(), and the solver finds shortest solutions on one thread
+// and on several. Exits with 1 if any check fails.
+
+namespace {
+
+using Game = BasicGame<3>;
+using Heuristic = BasicHeuristic<3>;
+using Database = BasicPatternDatabase<3>;
+using Heuristics = std::vector<std::pair<std::string, std::unique_ptr<Heuristic>>>;
+
+constexpr uint64_t Boards {SolvableCount<3>};
+constexpr uint8_t Unreached {0xFF};
+// Random boards solved per heuristic, mode and thread count.
+constexpr int32_t Samples {100};
+constexpr int32_t Threads {4};
+
+bool checkRanks() {
+    for (uint64_t index {0}; index < Boards; index++) {
+        Game game {unrank<3>(index)};
+        if (!game.isSolvable() || rank(game) != index) {
+            spdlog::error("Board {} does not round-trip through unrank and rank", index);
+            return false;
+        }
+    }
+
+    for (int32_t count {1}; count < Game::Size; count++) {
+        std::vector<int8_t> positions(static_cast<size_t>(count));
+        for (uint64_t index {0}; index < arrangements(Game::Size, count); index++) {
+            unrankPositions(index, positions, Game::Size);
+            if (rankPositions(positions, Game::Size) != index) {
+                spdlog::error("Placement {} of {} tiles does not round-trip", index, count);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Moves from every solvable board to the goal, by rank.
+std::vector<uint8_t> distances() {
+    std::vector<uint8_t> distance(Boards, Unreached);
+    std::vector<uint64_t> frontier {rank(Game {})};
+    distance[frontier[0]] = 0;
+
+    for (uint8_t depth {1}; !frontier.empty(); depth++) {
+        std::vector<uint64_t> next;
+        for (uint64_t index : frontier) {
+            Game game {unrank<3>(index)};
+            for (Move move : game.validMoves()) {
+                Game child {game};
+                child.move(move);
+
+                uint64_t childIndex {rank(child)};
+                if (distance[childIndex] == Unreached) {
+                    distance[childIndex] = depth;
+                    next.push_back(childIndex);
+                }
+            }
+        }
+
+        std::swap(frontier, next);
+    }
+
+    return distance;
+}
+
+bool checkHeuristic(const std::string& name, const Heuristic& heuristic, const std::vector<uint8_t>& distance) {
+    for (uint64_t index {0}; index < Boards; index++) {
+        Game game {unrank<3>(index)};
+        uint32_t h {heuristic.solve(game)};
+        if (h > distance[index]) {
+            spdlog::error("{}: estimate {} of board {} is over its distance {}", name, h, index, distance[index]);
+            return false;
+        }
+
+        for (Move move : game.validMoves()) {
+            Game child {game};
+            child.move(move);
+
+            uint32_t updated {heuristic.update(child, move, h)};
+            uint32_t solved {heuristic.solve(child)};
+            if (updated != solved) {
+                spdlog::error("{}: update gives {} after a move from board {}, solve {}", name, updated, index, solved);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool checkSolver(
+    const std::string& name,
+    const Heuristic& heuristic,
+    const std::vector<uint8_t>& distance,
+    SearchMode mode,
+    int32_t threads
+) {
+    BasicGenerator<3> generator {7};
+    BasicSolver<3> solver;
+
+    for (int32_t sample {0}; sample < Samples; sample++) {
+        Game game {generator.next()};
+        int32_t shortest {distance[rank(game)]};
+
+        solver.reset(game);
+        solver.setThreads(threads);
+        solver.setMode(mode, 1.5F);
+        solver.solve(heuristic);
+
+        if (solver.result() != SolverResult::OK || solver.path().front() != game || !solver.path().back().isSolved()) {
+            spdlog::error("{}: no solution for board {} on {} threads", name, rank(game), threads);
+            return false;
+        }
+
+        bool optimal {mode == SearchMode::OPTIMAL};
+        int32_t length {solver.length()};
+        if ((optimal ? length != shortest : length > shortest * 3 / 2) || solver.lowerBound() > shortest) {
+            spdlog::error(
+                "{}: solution of {} moves (>= {}) for board {} on {} threads, shortest is {}",
+                name,
+                length,
+                solver.lowerBound(),
+                rank(game),
+                threads,
+                shortest
+            );
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Pattern database heuristics are only made for 4x4 boards, so the 8-puzzle
+// ones are built here, for every encoding and reflection.
+void addPatternDatabases(Heuristics& heuristics) {
+    std::vector<Database> bytes;
+    for (std::vector<int8_t> tiles : {std::vector<int8_t> {1, 2, 3, 4}, std::vector<int8_t> {5, 6, 7, 8}})
+        bytes.push_back(*Database::build(std::move(tiles), 1));
+
+    constexpr std::pair<PatternEncoding, const char*> Encodings[] {
+        {PatternEncoding::BYTE, "byte"},
+        {PatternEncoding::NIBBLE, "nibble"},
+        {PatternEncoding::MOD3, "mod3"},
+    };
+    constexpr std::pair<PatternReflection, const char*> Reflections[] {
+        {PatternReflection::NONE, ""},
+        {PatternReflection::MAXIMUM, ", reflected"},
+        {PatternReflection::ALTERNATE, ", alternating"},
+    };
+
+    for (auto [encoding, encodingName] : Encodings) {
+        auto databases = std::make_shared<std::vector<Database>>(bytes);
+        if (encoding != PatternEncoding::BYTE) {
+            for (Database& database : *databases)
+                database = *database.encode(encoding);
+        }
+
+        for (auto [reflection, reflectionName] : Reflections) {
+            heuristics.emplace_back(
+                std::string {"Pattern database, "} + encodingName + reflectionName,
+                std::make_unique<BasicPatternDatabaseHeuristic<3>>(databases, reflection)
+            );
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    int32_t failures {0};
+
+    failures += !checkRanks();
+
+    std::vector<uint8_t> distance {distances()};
+    if (std::find(distance.begin(), distance.end(), Unreached) != distance.end()) {
+        spdlog::error("Some solvable boards are not reachable from the goal");
+        failures++;
+    }
+
+    Heuristics heuristics;
+    for (int32_t kind {0}; kind < static_cast<int32_t>(std::size(HeuristicNames)); kind++)
+        heuristics.emplace_back(HeuristicNames[kind], makeHeuristic<3>(static_cast<HeuristicKind>(kind)));
+    addPatternDatabases(heuristics);
+
+    for (const auto& [name, heuristic] : heuristics) {
+        failures += !checkHeuristic(name, *heuristic, distance);
+        for (SearchMode mode : {SearchMode::OPTIMAL, SearchMode::BOUNDED}) {
+            failures += !checkSolver(name, *heuristic, distance, mode, 1);
+            failures += !checkSolver(name, *heuristic, distance, mode, Threads);
+        }
+    }
+
+    if (failures != 0) {
+        spdlog::error("{} checks failed", failures);
+        return 1;
+    }
+
+    spdlog::info("All checks passed over {} boards and {} heuristics", Boards, heuristics.size());
+    return 0;
+}
@@ -1,82 +1,454 @@
 #include "Solver.hh"
+#include "PatternDatabase.hh"
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <optional>
+#include <thread>
 
-uint32_t Solver::search(
-    std::deque<Game>& path,
-    int32_t moveCost,
-    int32_t threshold,
-    const Heuristic& heuristic,
-    float weight
+// One iteration of IDA* below the worker's board, run on an explicit stack of
+// frames rather than by recursion, on a single board the blank is moved about
+// and moved back on. Returns 0 with the solution in the worker's moves, or
+// the smallest cost over the threshold.
+//
+// Costs are g + weight * estimate, scaled by WeightScale.
+//
+// h is the heuristic's own value, which incremental heuristics update from;
+// estimate starts at h and is raised with bidirectional pathmax (BPMX) so
+// that inconsistent heuristics lose none of their pruning. Estimates of
+// neighbours differ by at most the move between them, so every child's
+// estimate less one bounds its parent's, and the parent's less one bounds
+// every child's. The root's raised estimate is passed back through estimate.
+template <int32_t N>
+template <typename H>
+uint32_t BasicSolver<N>::search(
+    Worker& worker,
+    uint32_t h,
+    uint32_t& estimate,
+    uint32_t threshold,
+    const H& heuristic
 ) {
-    const Game& state = *path.rbegin();
+    // The stack never grows past the threshold: a child is only pushed with
+    // g + 1 within it, or when estimated at 0, and is then the goal or cut off
+    // before it has children of its own.
+    std::vector<Frame>& frames {worker.frames};
+    if (frames.size() < threshold / WeightScale + 2) {
+        frames.resize(threshold / WeightScale + 2);
+        worker.moves.reserve(frames.size());
+    }
+
+    Game& state {worker.state};
+    frames[0].g = static_cast<uint32_t>(worker.moves.size());
+    frames[0].h = h;
+    frames[0].estimate = estimate;
+
+    size_t depth {0};
+    uint32_t result {0};
+    bool entered {true};
+
+    while (true) {
+        Frame& frame {frames[depth]};
+        uint32_t cost;
+
+        if (entered) {
+            if (state.isSolved()) {
+                return 0;
+            }
+
+            cost = frame.g * WeightScale + frame.estimate * _weight;
+            if (cost <= threshold) {
+                // Once the search is to end, what this returns no longer
+                // matters.
+                worker.nodes++;
+                if (worker.nodes % StopInterval == 0 && interrupted()) {
+                    return std::numeric_limits<uint32_t>::max();
+                }
+
+                // Smallest child estimate that gets the child pruned;
+                // heuristics that can stop early once they reach it are
+                // given it.
+                int64_t slack {int64_t {threshold} - (frame.g + 1) * WeightScale};
+                uint32_t bound {slack < 0 ? 1 : static_cast<uint32_t>(slack / _weight + 1)};
+
+                // Children are all evaluated before the first is searched,
+                // so that any of them can raise this node's estimate.
+                frame.count = 0;
+                MoveSet candidates {worker.moves.empty() ? state.validMoves() : state.validMoves(worker.moves.back())};
+                for (Move nextMove : candidates) {
+                    state.move(nextMove);
+
+                    if (!_detectCycles || !worker.onPath.contains(state.hash())) {
+                        uint32_t value;
+                        if constexpr (requires { heuristic.update(state, nextMove, frame.h, bound); })
+                            value = heuristic.update(state, nextMove, frame.h, bound);
+                        else
+                            value = heuristic.update(state, nextMove, frame.h);
+
+                        frame.estimate = std::max(frame.estimate, value - std::min(value, 1U));
+                        frame.moves[frame.count] = nextMove;
+                        frame.values[frame.count++] = value;
+                    }
 
-    uint32_t h = heuristic.solve(state);
+                    state.move(inverse(nextMove));
+                }
+
+                frame.cursor = 0;
+                frame.min = std::numeric_limits<uint32_t>::max();
+                cost = frame.g * WeightScale + frame.estimate * _weight;
+            }
+        } else {
+            // Back from the child before the cursor, which returned result.
+            if (_detectCycles)
+                worker.onPath.erase(state.hash());
+            worker.moves.pop_back();
+            state.move(inverse(frame.moves[frame.cursor - 1]));
+
+            frame.min = std::min(frame.min, result);
+
+            uint32_t childEstimate {frames[depth + 1].estimate};
+            if (childEstimate > frame.estimate + 1)
+                frame.estimate = childEstimate - 1;
+
+            cost = frame.g * WeightScale + frame.estimate * _weight;
+        }
+
+        entered = false;
+        if (cost <= threshold) {
+            while (frame.cursor < frame.count) {
+                Move nextMove {frame.moves[frame.cursor]};
+                uint32_t value {frame.values[frame.cursor++]};
+                uint32_t nextEstimate {std::max(value, frame.estimate - std::min(frame.estimate, 1U))};
+
+                // Children over the threshold are not worth moving to.
+                uint32_t nextCost = (frame.g + 1) * WeightScale + nextEstimate * _weight;
+                if (nextEstimate != 0 && nextCost > threshold) {
+                    frame.min = std::min(frame.min, nextCost);
+                    continue;
+                }
+
+                state.move(nextMove);
+                worker.moves.push_back(nextMove);
+                if (_detectCycles)
+                    worker.onPath.insert(state.hash());
+
+                Frame& child {frames[++depth]};
+                child.g = frame.g + 1;
+                child.h = value;
+                child.estimate = nextEstimate;
+                entered = true;
+                break;
+            }
 
-    if (h == 0) {
-        return 0;
+            if (!entered)
+                cost = frame.min;
+        }
+
+        if (!entered) {
+            if (depth == 0) {
+                estimate = frame.estimate;
+                return cost;
+            }
+
+            depth--;
+            result = cost;
+        }
     }
+}
+
+template <int32_t N>
+SolverProgress BasicSolver<N>::progress() const {
+    std::chrono::steady_clock::time_point started {
+        std::chrono::steady_clock::duration {_started.load(std::memory_order_relaxed)}
+    };
+    std::chrono::duration<float> elapsed {std::chrono::steady_clock::now() - started};
+    uint64_t nodes {_expanded.load(std::memory_order_relaxed)};
+
+    return {
+        static_cast<float>(_threshold.load(std::memory_order_relaxed)) / static_cast<float>(_weight),
+        nodes,
+        elapsed.count() > 0.F ? static_cast<float>(nodes) / elapsed.count() : 0.F,
+    };
+}
+
+template <int32_t N>
+bool BasicSolver<N>::interrupted() {
+    uint64_t nodes {_expanded.fetch_add(StopInterval, std::memory_order_relaxed) + StopInterval};
+    if (_stop.load(std::memory_order_relaxed))
+        return true;
+
+    SolverResult reason;
+    if (_stopToken.stop_requested())
+        reason = SolverResult::CANCELLED;
+    else if (_nodeLimit != 0 && nodes >= _nodeLimit)
+        reason = SolverResult::NODE_LIMIT_REACHED;
+    else if (_timeLimit.count() != 0 && std::chrono::steady_clock::now() >= _deadline)
+        reason = SolverResult::TIME_LIMIT_REACHED;
+    else
+        return false;
 
-    uint32_t cost = moveCost + h * weight;
-    if (cost > static_cast<uint32_t>(threshold)) {
-        return cost;
+    SolverResult expected {SolverResult::OK};
+    _stopReason.compare_exchange_strong(expected, reason);
+    _stop = true;
+    return true;
+}
+
+template <int32_t N>
+void BasicSolver<N>::solve(const Heuristic& heuristic, std::stop_token stop) {
+    _stopToken = std::move(stop);
+
+    if (auto manhattan = dynamic_cast<const BasicManhattanDistance<N>*>(&heuristic)) {
+        run(*manhattan);
+    } else if (auto conflict = dynamic_cast<const BasicLinearConflict<N>*>(&heuristic)) {
+        run(*conflict);
+    } else if (auto pattern = dynamic_cast<const BasicPatternDatabaseHeuristic<N>*>(&heuristic)) {
+        run(*pattern);
+    } else if (auto maximum = dynamic_cast<const BasicMaxHeuristic<N>*>(&heuristic)) {
+        run(*maximum);
+    } else if constexpr (N <= 4) {
+        if (auto walking = dynamic_cast<const BasicWalkingDistance<N>*>(&heuristic))
+            run(*walking);
+        else
+            run(heuristic);
+    } else {
+        run(heuristic);
     }
+}
 
-    uint32_t min = std::numeric_limits<uint32_t>::max();
+// Expands the tree breadth first from _game until a layer holds enough
+// boards to keep every thread busy, dropping those the threshold prunes.
+// Returns 0 with the solution in _moves if a layer reaches the goal, or else
+// the smallest cost of the boards dropped.
+template <int32_t N>
+template <typename H>
+uint32_t BasicSolver<N>::split(
+    uint32_t h,
+    uint32_t threshold,
+    const H& heuristic,
+    std::vector<Subproblem>& frontier
+) {
+    constexpr size_t PerThread {256};
 
-    for (Move& nextMove : state.validMoves()) {
-        Game nextState {state};
-        nextState.move(nextMove);
+    uint32_t min = std::numeric_limits<uint32_t>::max();
+    std::vector<Subproblem> layer;
 
-        if (std::find(path.begin(), path.end(), nextState) == path.end()) {
-            path.push_back(std::move(nextState));
+    frontier.clear();
+    frontier.push_back({_game, {}, h});
+    while (!frontier.empty() && frontier.size() < PerThread * _threads) {
+        std::swap(layer, frontier);
+        frontier.clear();
 
-            uint32_t temp = search(path, moveCost + 1, threshold, heuristic, weight);
-            if (temp == 0) {
+        for (const Subproblem& node : layer) {
+            if (node.state.isSolved()) {
+                _moves = node.moves;
                 return 0;
             }
 
-            if (temp < min) {
-                min = temp;
-            }
+            _nodes++;
+            for (Move move : node.moves.empty() ? node.state.validMoves() : node.state.validMoves(node.moves.back())) {
+                Subproblem child {node.state, node.moves, 0};
+                child.state.move(move);
+                child.moves.push_back(move);
+                child.h = heuristic.update(child.state, move, node.h);
+
+                uint32_t cost = static_cast<uint32_t>(child.moves.size()) * WeightScale + child.h * _weight;
+                if (child.h != 0 && cost > threshold) {
+                    min = std::min(min, cost);
+                    continue;
+                }
 
-            path.pop_back();
+                frontier.push_back(std::move(child));
+            }
         }
     }
 
     return min;
 }
 
-void Solver::solve(const Heuristic& heuristic) {
+template <int32_t N>
+template <typename H>
+bool BasicSolver<N>::runSequential(uint32_t h, uint32_t& threshold, const H& heuristic) {
+    Worker worker {_game};
+    worker.onPath.insert(worker.state.hash());
+
+    uint32_t estimate = h;
+
+    uint32_t result = -1;
+    while (result != 0) {
+        _threshold.store(threshold, std::memory_order_relaxed);
+        result = search(worker, h, estimate, threshold, heuristic);
+        _nodes = worker.nodes;
+
+        if (result == std::numeric_limits<uint32_t>::max()) {
+            return false;
+        }
+
+        if (result != 0)
+            threshold = result;
+    }
+
+    _moves = std::move(worker.moves);
+    return true;
+}
+
+// Every threshold the tree is split near the root and the subproblems are
+// dealt out to the threads in contiguous ranges. A thread takes from the
+// front of its own range, and once that is empty steals the back half of
+// another thread's. The smallest cost over the threshold is shared between
+// the threads and becomes the next threshold. Any solution found within the
+// threshold is as short as any other, so the first one stops every thread,
+// as does a stop or limit any thread notices.
+template <int32_t N>
+template <typename H>
+bool BasicSolver<N>::runParallel(uint32_t h, uint32_t& threshold, const H& heuristic) {
+    auto pack = [](uint64_t begin, uint64_t end) {
+        return begin << 32 | end;
+    };
+
+    std::vector<Subproblem> frontier;
+    std::vector<Worker> workers(_threads);
+    // Subproblems each thread has left, as begin << 32 | end.
+    std::vector<std::atomic<uint64_t>> ranges(_threads);
+    std::atomic<bool> found {false};
+    std::atomic<uint32_t> next {0};
+
+    // Index of the next subproblem for the given thread, or none once there
+    // is nothing left to take or steal.
+    auto take = [&](size_t index) -> std::optional<uint32_t> {
+        std::atomic<uint64_t>& own {ranges[index]};
+        uint64_t range {own.load()};
+        while ((range >> 32) < (range & 0xFFFFFFFF)) {
+            if (own.compare_exchange_weak(range, range + (uint64_t {1} << 32)))
+                return static_cast<uint32_t>(range >> 32);
+        }
+
+        for (size_t offset {1}; offset < ranges.size(); offset++) {
+            std::atomic<uint64_t>& victim {ranges[(index + offset) % ranges.size()]};
+            range = victim.load();
+            while ((range >> 32) < (range & 0xFFFFFFFF)) {
+                uint64_t begin {range >> 32};
+                uint64_t end {range & 0xFFFFFFFF};
+                uint64_t half {end - (end - begin + 1) / 2};
+                if (victim.compare_exchange_weak(range, pack(begin, half))) {
+                    own.store(pack(half + 1, end));
+                    return static_cast<uint32_t>(half);
+                }
+            }
+        }
+
+        return std::nullopt;
+    };
+
+    while (true) {
+        _threshold.store(threshold, std::memory_order_relaxed);
+        uint32_t min = split(h, threshold, heuristic, frontier);
+        if (min == 0)
+            return true;
+
+        next = min;
+        for (size_t t {0}; t < ranges.size(); t++)
+            ranges[t] = pack(frontier.size() * t / ranges.size(), frontier.size() * (t + 1) / ranges.size());
+
+        auto work = [&](size_t index) {
+            Worker& worker {workers[index]};
+
+            while (auto task = take(index)) {
+                const Subproblem& node {frontier[*task]};
+
+                worker.state = _game;
+                worker.moves.clear();
+                worker.onPath.clear();
+                worker.onPath.insert(worker.state.hash());
+                for (Move move : node.moves) {
+                    worker.state.move(move);
+                    worker.moves.push_back(move);
+                    worker.onPath.insert(worker.state.hash());
+                }
+
+                uint32_t estimate {node.h};
+                uint32_t result {search(worker, node.h, estimate, threshold, heuristic)};
+                if (result == 0) {
+                    if (!found.exchange(true))
+                        _moves = worker.moves;
+                    _stop = true;
+                    return;
+                }
+
+                if (_stop.load(std::memory_order_relaxed))
+                    return;
+
+                uint32_t current {next.load()};
+                while (result < current && !next.compare_exchange_weak(current, result)) {}
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(workers.size() - 1);
+        for (size_t t {1}; t < workers.size(); t++)
+            threads.emplace_back(work, t);
+        work(0);
+        for (std::thread& thread : threads)
+            thread.join();
+
+        for (const Worker& worker : workers)
+            _nodes += worker.nodes;
+        for (Worker& worker : workers)
+            worker.nodes = 0;
+
+        if (found)
+            return true;
+        if (_stop || next == std::numeric_limits<uint32_t>::max())
+            return false;
+
+        threshold = next;
+    }
+}
+
+template <int32_t N>
+template <typename H>
+void BasicSolver<N>::run(const H& heuristic) {
     _startTime = std::chrono::steady_clock::now();
+    _deadline = _startTime + _timeLimit;
     _solved = false;
+    _nodes = 0;
+    _stop = false;
+    _stopReason = SolverResult::OK;
+    _threshold = 0;
+    _expanded = 0;
+    _started = _startTime.time_since_epoch().count();
 
     if (!_game.isSolvable()) {
         _result = SolverResult::NOT_SOLVABLE;
         return;
     }
 
-    std::deque<Game> path;
-    path.push_back(_game);
+    _moves.clear();
+    uint32_t h = heuristic.solve(_game);
+    uint32_t threshold = h * _weight;
 
-    uint32_t threshold = heuristic.solve(_game);
+    bool found {_threads > 1 ? runParallel(h, threshold, heuristic) : runSequential(h, threshold, heuristic)};
+    _expanded = _nodes;
+    _endTime = std::chrono::steady_clock::now();
 
-    float weight = 1.5F;
-    uint32_t result = -1;
-    while (result != 0) {
-        result = search(path, 0, threshold, heuristic, weight);
+    if (!found) {
+        _result = _stopReason != SolverResult::OK ? _stopReason.load() : SolverResult::NO_SOLUTION_FOUND;
+        return;
+    }
 
-        if (result == std::numeric_limits<uint32_t>::max()) {
-            _result = SolverResult::NO_SOLUTION_FOUND;
-            return;
-        }
+    // Every board on a shortest solution costs at most weight times its
+    // length, and one of them was over the threshold before the last.
+    _lowerBound = std::min(static_cast<int32_t>((threshold + _weight - 1) / _weight), length());
 
-        threshold = result;
+    _path.reserve(_moves.size() + 1);
+    _path.push_back(_game);
+    for (Move move : _moves) {
+        _path.push_back(_path.back());
+        _path.back().move(move);
     }
 
-    _path.reserve(path.size());
-    std::move(std::begin(path), std::end(path), std::back_inserter(_path));
-
     _solved = true;
-    _endTime = std::chrono::steady_clock::now();
-
     _result = SolverResult::OK;
 }
+
+template class BasicSolver<3>;
+template class BasicSolver<4>;
+template class BasicSolver<5>;
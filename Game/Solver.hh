@@ -2,22 +2,153 @@
 
 #include "Game.hh"
 #include "Heuristic.hh"
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
-#include <deque>
+#include <cmath>
+#include <cstdint>
+#include <stop_token>
 #include <vector>
 
-enum class SolverResult { OK, NOT_SOLVABLE, NO_SOLUTION_FOUND };
+enum class SolverResult {
+    OK,
+    NOT_SOLVABLE,
+    NO_SOLUTION_FOUND,
+    CANCELLED,
+    TIME_LIMIT_REACHED,
+    NODE_LIMIT_REACHED
+};
+
+// State of a running search, read without locking from any thread.
+struct SolverProgress {
+    // Cost bound of the current iteration over the weight, in moves. Once the
+    // iteration ends without a solution, none is shorter; see lowerBound().
+    float threshold;
+    uint64_t nodes;
+    float nodesPerSecond;
+};
+
+// OPTIMAL finds a shortest solution. BOUNDED weighs the heuristic up, which
+// finds solutions at most that many times longer much sooner.
+enum class SearchMode { OPTIMAL, BOUNDED };
+
+// Hashes of the boards on the search path, in an open addressing table kept
+// at most half full. Erasing shifts later entries of the probe run back into
+// the freed slot, so no run is ever broken, whatever order boards leave in.
+// Two boards sharing a hash count as one; with 64-bit hashes that never
+// matters in practice.
+class PathSet {
+public:
+    bool contains(uint64_t hash) const {
+        for (size_t slot {key(hash) & _mask}; _slots[slot] != 0; slot = (slot + 1) & _mask) {
+            if (_slots[slot] == key(hash))
+                return true;
+        }
+
+        return false;
+    }
+
+    void insert(uint64_t hash) {
+        if (2 * (_size + 1) > _slots.size())
+            grow();
+
+        size_t slot {key(hash) & _mask};
+        while (_slots[slot] != 0)
+            slot = (slot + 1) & _mask;
+
+        _slots[slot] = key(hash);
+        _size++;
+    }
+
+    // The hash must be in the set.
+    void erase(uint64_t hash) {
+        size_t hole {key(hash) & _mask};
+        while (_slots[hole] != key(hash))
+            hole = (hole + 1) & _mask;
+
+        // An entry further along the run moves into the hole unless its home
+        // slot lies after the hole, where a probe would no longer find it.
+        for (size_t slot {(hole + 1) & _mask}; _slots[slot] != 0; slot = (slot + 1) & _mask) {
+            size_t home {_slots[slot] & _mask};
+            if (((slot - home) & _mask) >= ((slot - hole) & _mask)) {
+                _slots[hole] = _slots[slot];
+                hole = slot;
+            }
+        }
+
+        _slots[hole] = 0;
+        _size--;
+    }
+
+    void clear() {
+        std::fill(_slots.begin(), _slots.end(), 0);
+        _size = 0;
+    }
+
+private:
+    // Zero marks an empty slot.
+    static uint64_t key(uint64_t hash) {
+        return hash != 0 ? hash : 1;
+    }
+
+    void grow() {
+        std::vector<uint64_t> slots(std::max<size_t>(2 * _slots.size(), 64));
+        std::swap(_slots, slots);
+        _mask = _slots.size() - 1;
+
+        for (uint64_t hash : slots) {
+            if (hash == 0)
+                continue;
 
-class Solver {
+            size_t slot {hash & _mask};
+            while (_slots[slot] != 0)
+                slot = (slot + 1) & _mask;
+            _slots[slot] = hash;
+        }
+    }
+
+    std::vector<uint64_t> _slots = std::vector<uint64_t>(64);
+    size_t _mask {63};
+    size_t _size {0};
+};
+
+template <int32_t N>
+class BasicSolver {
 public:
+    using Game = BasicGame<N>;
+    using Heuristic = BasicHeuristic<N>;
+
     void reset(Game game) {
         _game = game;
         _solved = false;
+        _nodes = 0;
+        _lowerBound = 0;
+        _moves.clear();
         _path.clear();
         _startTime = std::chrono::steady_clock::now();
     }
 
-    void solve(const Heuristic& heuristic);
+    // Runs the search instantiated for the concrete type of every shipped
+    // heuristic, so its update() inlines into the expansion loop; other
+    // heuristics go through virtual calls. A stop requested on the token
+    // ends the search with CANCELLED.
+    void solve(const Heuristic& heuristic, std::stop_token stop = {});
+
+    // Nodes expanded and time taken after which the search gives up; zero
+    // sets no limit. Like the stop token, these are checked every
+    // StopInterval nodes, so the search may run slightly past them.
+    void setNodeLimit(uint64_t nodes) {
+        _nodeLimit = nodes;
+    }
+
+    void setTimeLimit(std::chrono::milliseconds time) {
+        _timeLimit = time;
+    }
+
+    // May be called while solve() runs on another thread. Nodes are counted
+    // StopInterval at a time per thread.
+    SolverProgress progress() const;
 
     std::chrono::milliseconds elapsed() const {
         return std::chrono::duration_cast<std::chrono::milliseconds>(_endTime - _startTime);
@@ -31,23 +162,134 @@ public:
         return _result;
     }
 
+    // Nodes expanded by the last search, over all iterations.
+    uint64_t nodes() const {
+        return _nodes;
+    }
+
+    // The move back to the parent is never tried. Longer cycles are cut by a
+    // hashed set of the boards on the path, unless this is turned off.
+    void setCycleDetection(bool enabled) {
+        _detectCycles = enabled;
+    }
+
+    // Weights are kept in fixed point, in steps of 1 / WeightScale, so the
+    // cost test is integer arithmetic. OPTIMAL ignores the weight.
+    void setMode(SearchMode mode, float weight = 1.F) {
+        _mode = mode;
+        _weight = WeightScale;
+        if (mode == SearchMode::BOUNDED)
+            _weight = std::max(static_cast<uint32_t>(std::lround(weight * WeightScale)), WeightScale);
+    }
+
+    SearchMode mode() const {
+        return _mode;
+    }
+
+    float weight() const {
+        return static_cast<float>(_weight) / WeightScale;
+    }
+
+    // Moves in the solution found.
+    int32_t length() const {
+        return static_cast<int32_t>(_moves.size());
+    }
+
+    // Length no solution can be shorter than, proven by the search. The
+    // solution found is optimal if it matches length().
+    int32_t lowerBound() const {
+        return _lowerBound;
+    }
+
+    // Threads the search runs on. With more than one, the tree near the root
+    // is split into subproblems that the threads share out and steal from
+    // each other, one threshold at a time.
+    void setThreads(int32_t threads) {
+        _threads = std::max(threads, 1);
+    }
+
     std::vector<Game>& path() {
         return _path;
     }
 
 private:
-    uint32_t search(
-        std::deque<Game>& path,
-        int32_t moveCost,
-        int32_t threshold,
-        const Heuristic& heuristic,
-        float weight
-    );
+    static constexpr uint32_t WeightScale {256};
+    static constexpr uint64_t StopInterval {1024};
+
+    // One level of the search stack. The children are evaluated when the frame
+    // is entered and tried in order from cursor on.
+    struct Frame {
+        std::array<Move, 4> moves;
+        std::array<uint32_t, 4> values;
+        uint32_t h;
+        uint32_t estimate;
+        uint32_t min;
+        uint32_t g;
+        uint8_t count;
+        uint8_t cursor;
+    };
+
+    // What one thread searches with: its own board, the moves that led there
+    // from _game, the boards on that path and the frame stack.
+    struct Worker {
+        Game state;
+        std::vector<Move> moves {};
+        PathSet onPath {};
+        std::vector<Frame> frames {};
+        uint64_t nodes {0};
+    };
+
+    // Board near the root, searched as a whole by one worker.
+    struct Subproblem {
+        Game state;
+        std::vector<Move> moves;
+        uint32_t h;
+    };
+
+    template <typename H>
+    void run(const H& heuristic);
+
+    // Counts StopInterval more nodes and tells whether the search is to end,
+    // either because it was found or a stop or limit was reached.
+    bool interrupted();
+
+    template <typename H>
+    bool runSequential(uint32_t h, uint32_t& threshold, const H& heuristic);
+
+    template <typename H>
+    bool runParallel(uint32_t h, uint32_t& threshold, const H& heuristic);
+
+    template <typename H>
+    uint32_t split(uint32_t h, uint32_t threshold, const H& heuristic, std::vector<Subproblem>& frontier);
+
+    template <typename H>
+    uint32_t search(Worker& worker, uint32_t h, uint32_t& estimate, uint32_t threshold, const H& heuristic);
 
     SolverResult _result;
     bool _solved {false};
+    bool _detectCycles {true};
+    SearchMode _mode {SearchMode::OPTIMAL};
+    uint32_t _weight {WeightScale};
+    int32_t _lowerBound {0};
+    int32_t _threads {1};
+    uint64_t _nodes {0};
     Game _game;
+    // Moves from _game to the goal, once one is found.
+    std::vector<Move> _moves {};
+    std::stop_token _stopToken {};
+    uint64_t _nodeLimit {0};
+    std::chrono::milliseconds _timeLimit {0};
+    std::chrono::time_point<std::chrono::steady_clock> _deadline {};
+    // Set once every thread is to stop, and why if not for a solution.
+    std::atomic<bool> _stop {false};
+    std::atomic<SolverResult> _stopReason {SolverResult::OK};
+    // Progress, kept for other threads to read.
+    std::atomic<uint32_t> _threshold {0};
+    std::atomic<uint64_t> _expanded {0};
+    std::atomic<std::chrono::steady_clock::rep> _started {0};
     std::chrono::time_point<std::chrono::steady_clock> _startTime {};
     std::chrono::time_point<std::chrono::steady_clock> _endTime {};
     std::vector<Game> _path {};
 };
+
+using Solver = BasicSolver<4>;